@@ -51,10 +51,11 @@
 #include <streambuf>
 #include <unordered_set>
 #include <mutex> 
-#include <queue>
+#include <atomic>
 #include <thread>
 #include <cerrno>
 #include <limits>
+#include <deque>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -73,6 +74,51 @@ void debugLog(const std::string& msg) {
     if (DEBUG_MODE)
         std::cout << "[DEBUG] " << msg << std::endl;
 }
+
+// ----------------------------------------------------------------------------
+// Trace categories (--dc general,compiler,vm,stack,plugin). --d true enables
+// all of them. DEBUG_TRACE only builds its message when tracing is on for the
+// category, so the VM pays a single flag test per trace point. Build with
+// -DCROSSBASIC_NO_TRACE to compile tracing out entirely.
+// ----------------------------------------------------------------------------
+enum TraceCategory : unsigned {
+    TRACE_GENERAL  = 1u << 0, // startup, parser, bytecode loading
+    TRACE_COMPILER = 1u << 1,
+    TRACE_VM       = 1u << 2, // instruction dispatch, calls, variables
+    TRACE_STACK    = 1u << 3, // stack dump after every instruction
+    TRACE_PLUGIN   = 1u << 4, // plugin loading, FFI, callbacks
+    TRACE_ALL      = ~0u
+};
+unsigned DEBUG_CATEGORIES = TRACE_ALL;
+
+#ifdef CROSSBASIC_NO_TRACE
+inline bool traceEnabled(unsigned) { return false; }
+// The message is still type-checked but never evaluated.
+#define DEBUG_TRACE(category, msg) do { if (false) debugLog(msg); } while (0)
+#else
+inline bool traceEnabled(unsigned category) {
+    return DEBUG_MODE && (DEBUG_CATEGORIES & category) != 0;
+}
+#define DEBUG_TRACE(category, msg) do { if (traceEnabled(category)) debugLog(msg); } while (0)
+#endif
+
+// Parse a comma-separated category list for --dc. Returns false on unknown names.
+bool parseTraceCategories(const std::string& list, unsigned& mask) {
+    mask = 0;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        std::transform(item.begin(), item.end(), item.begin(), ::tolower);
+        if (item == "general")       mask |= TRACE_GENERAL;
+        else if (item == "compiler") mask |= TRACE_COMPILER;
+        else if (item == "vm")       mask |= TRACE_VM;
+        else if (item == "stack")    mask |= TRACE_STACK;
+        else if (item == "plugin")   mask |= TRACE_PLUGIN;
+        else if (item == "all")      mask |= TRACE_ALL;
+        else return false;
+    }
+    return mask != 0;
+}
 std::chrono::steady_clock::time_point startTime;
 
 // ---------------------------------------------------------------------------  
@@ -96,6 +142,7 @@ struct ObjFunction;
 struct ObjClass;
 struct ObjInstance;
 struct ObjArray;
+struct ObjDictionary;
 struct ObjBoundMethod;
 struct ObjModule;
 struct ObjRef;
@@ -117,9 +164,11 @@ struct ObjEnum {
 };
 
 // ============================================================================  
-// Built-in function type
+// Built-in function type. Arguments arrive as an ArgSpan (defined after
+// Value), usually a view straight onto the VM stack.
 // ============================================================================
-using BuiltinFn = std::function<struct Value(const std::vector<struct Value>&)>;
+struct ArgSpan;
+using BuiltinFn = std::function<struct Value(ArgSpan)>;
 
 // ----------------------------------------------------------------------------  
 // For class property defaults we use a property map
@@ -127,33 +176,41 @@ using BuiltinFn = std::function<struct Value(const std::vector<struct Value>&)>;
 using PropertiesType = std::vector<std::pair<std::string, struct Value>>;
 
 // ============================================================================  
-// Dynamic Value type – a wrapper around std::variant
-// Now includes pointer type (void*) for pointer variables.
+// Dynamic Value type – a compact tagged value (16 bytes).
+// nil, Integer, Double, Boolean, Color and Ptr are stored inline. Every other
+// alternative lives in a reference-counted heap box, so copying a Value is a
+// plain copy or a single refcount bump – never a string or std::function copy.
+// The alternatives (and their order/tags) are the ones the old std::variant
+// had; use holds<T>, getVal<T>, valueRef<T> and visitValue to inspect them.
 // ============================================================================
-// By Design - Not a duplication mistake: The duplicate "using" declaration 
-// inherits std::variant's constructors so Value can be directly constructed 
-// from any of its alternatives.
-struct Value : public std::variant<
-    std::monostate,
-    int,
-    double,
-    bool,
-    std::string,
-    Color,
-    std::shared_ptr<ObjFunction>,
-    std::shared_ptr<ObjClass>,
-    std::shared_ptr<ObjInstance>,
-    std::shared_ptr<ObjArray>,
-    std::shared_ptr<ObjBoundMethod>,
-    BuiltinFn,
-    PropertiesType,
-    std::vector<std::shared_ptr<ObjFunction>>,
-    std::shared_ptr<ObjModule>,
-    std::shared_ptr<ObjEnum>,
-    std::shared_ptr<ObjRef>,
-    void* // Pointer type
-> {
-    using std::variant<
+template<typename... Ts> struct TypeList {};
+
+template<typename T, typename... Ts> struct TypeIndex;
+template<typename T, typename... Ts>
+struct TypeIndex<T, T, Ts...> : std::integral_constant<uint8_t, 0> {};
+template<typename T, typename U, typename... Ts>
+struct TypeIndex<T, U, Ts...> : std::integral_constant<uint8_t, 1 + TypeIndex<T, Ts...>::value> {};
+
+template<typename T, typename List> struct TypeListIndex;
+template<typename T, typename... Ts>
+struct TypeListIndex<T, TypeList<Ts...>> : TypeIndex<T, Ts...> {};
+
+// Heap storage for the non-inline alternatives.
+struct ValueBox {
+    std::atomic<int> refs{ 1 };
+    virtual ~ValueBox() = default;
+    virtual ValueBox* clone() const = 0;
+};
+
+template<typename T>
+struct ValueBoxOf final : ValueBox {
+    T value;
+    explicit ValueBoxOf(T v) : value(std::move(v)) {}
+    ValueBox* clone() const override { return new ValueBoxOf<T>(value); }
+};
+
+struct Value {
+    using Types = TypeList<
         std::monostate,
         int,
         double,
@@ -171,8 +228,199 @@ struct Value : public std::variant<
         std::shared_ptr<ObjModule>,
         std::shared_ptr<ObjEnum>,
         std::shared_ptr<ObjRef>,
-        void*
-    >::variant;
+        void*, // Pointer type
+        std::shared_ptr<ObjDictionary>
+    >;
+
+    template<typename T>
+    static constexpr uint8_t tagOf = TypeListIndex<T, Types>::value;
+
+    template<typename T>
+    static constexpr bool isInline =
+        std::is_same_v<T, std::monostate> || std::is_same_v<T, int> ||
+        std::is_same_v<T, double> || std::is_same_v<T, bool> ||
+        std::is_same_v<T, Color> || std::is_same_v<T, void*>;
+
+    // ---- Construction ------------------------------------------------------
+    Value() noexcept : tag(tagOf<std::monostate>) { u.p = nullptr; }
+    Value(std::monostate) noexcept : Value() {}
+    Value(int v) noexcept : tag(tagOf<int>) { u.i = v; }
+    Value(double v) noexcept : tag(tagOf<double>) { u.d = v; }
+    Value(bool v) noexcept : tag(tagOf<bool>) { u.b = v; }
+    Value(Color v) noexcept : tag(tagOf<Color>) { u.c = v; }
+    Value(void* v) noexcept : tag(tagOf<void*>) { u.p = v; }
+
+    Value(const char* s) : Value(std::string(s)) {}
+    Value(std::string v)                                : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjFunction> v)               : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjClass> v)                  : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjInstance> v)               : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjArray> v)                  : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjBoundMethod> v)            : Value(boxed(std::move(v))) {}
+    Value(BuiltinFn v)                                  : Value(boxed(std::move(v))) {}
+    Value(PropertiesType v)                             : Value(boxed(std::move(v))) {}
+    Value(std::vector<std::shared_ptr<ObjFunction>> v)  : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjModule> v)                 : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjEnum> v)                   : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjRef> v)                    : Value(boxed(std::move(v))) {}
+    Value(std::shared_ptr<ObjDictionary> v)             : Value(boxed(std::move(v))) {}
+
+    // Lambdas and other callables become builtins.
+    template<typename F, typename = std::enable_if_t<
+        !std::is_same_v<std::decay_t<F>, BuiltinFn> &&
+        !std::is_same_v<std::decay_t<F>, Value> &&
+        std::is_invocable_r_v<Value, F&, ArgSpan>>>
+    Value(F&& f) : Value(BuiltinFn(std::forward<F>(f))) {}
+
+    Value(const Value& o) noexcept : tag(o.tag), u(o.u) {
+        if (isBoxed()) u.box->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    Value(Value&& o) noexcept : tag(o.tag), u(o.u) {
+        o.tag = tagOf<std::monostate>;
+        o.u.p = nullptr;
+    }
+    Value& operator=(const Value& o) noexcept {
+        if (this != &o) {
+            if (o.isBoxed()) o.u.box->refs.fetch_add(1, std::memory_order_relaxed);
+            release();
+            tag = o.tag;
+            u = o.u;
+        }
+        return *this;
+    }
+    Value& operator=(Value&& o) noexcept {
+        if (this != &o) {
+            release();
+            tag = o.tag;
+            u = o.u;
+            o.tag = tagOf<std::monostate>;
+            o.u.p = nullptr;
+        }
+        return *this;
+    }
+    ~Value() { release(); }
+
+    // ---- Inspection --------------------------------------------------------
+    uint8_t index() const noexcept { return tag; }
+
+    template<typename T>
+    bool is() const noexcept { return tag == tagOf<T>; }
+
+    // True when the boxed payload is also held by another Value.
+    bool shared() const noexcept {
+        return isBoxed() && u.box->refs.load(std::memory_order_acquire) != 1;
+    }
+
+    template<typename T>
+    const T& ref() const {
+        if (tag != tagOf<T>) throw std::bad_variant_access();
+        if constexpr (std::is_same_v<T, std::monostate>) { static const std::monostate nil; return nil; }
+        else if constexpr (std::is_same_v<T, int>)    return u.i;
+        else if constexpr (std::is_same_v<T, double>) return u.d;
+        else if constexpr (std::is_same_v<T, bool>)   return u.b;
+        else if constexpr (std::is_same_v<T, Color>)  return u.c;
+        else if constexpr (std::is_same_v<T, void*>)  return u.p;
+        else return static_cast<const ValueBoxOf<T>*>(u.box)->value;
+    }
+
+    // Mutable access; a shared box is copied first so other Values holding
+    // the same payload are unaffected.
+    template<typename T>
+    T& mut() {
+        if constexpr (!isInline<T>) {
+            if (tag == tagOf<T> && u.box->refs.load(std::memory_order_acquire) != 1) {
+                ValueBox* copy = u.box->clone();
+                release();
+                tag = tagOf<T>;
+                u.box = copy;
+            }
+        }
+        return const_cast<T&>(ref<T>());
+    }
+
+private:
+    struct Boxed { uint8_t tag; ValueBox* box; };
+
+    template<typename T>
+    static Boxed boxed(T&& v) {
+        using U = std::decay_t<T>;
+        return Boxed{ tagOf<U>, new ValueBoxOf<U>(std::forward<T>(v)) };
+    }
+    Value(Boxed b) noexcept : tag(b.tag) { u.box = b.box; }
+
+    bool isBoxed() const noexcept { return (kBoxedTags >> tag) & 1u; }
+
+    void release() noexcept {
+        if (isBoxed() && u.box->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete u.box;
+    }
+
+    static constexpr uint32_t kBoxedTags =
+        ~((1u << tagOf<std::monostate>) | (1u << tagOf<int>) | (1u << tagOf<double>) |
+          (1u << tagOf<bool>) | (1u << tagOf<Color>) | (1u << tagOf<void*>));
+
+    uint8_t tag;
+    union Payload {
+        int i;
+        double d;
+        bool b;
+        Color c;
+        void* p;
+        ValueBox* box;
+    } u;
+};
+static_assert(sizeof(Value) == 16, "Value should stay two machine words");
+
+// Calls visitor with the active alternative of v (the std::visit equivalent).
+template<typename Visitor>
+auto visitValue(Visitor&& visitor, const Value& v) {
+    switch (v.index()) {
+    case Value::tagOf<int>:                                       return visitor(v.ref<int>());
+    case Value::tagOf<double>:                                    return visitor(v.ref<double>());
+    case Value::tagOf<bool>:                                      return visitor(v.ref<bool>());
+    case Value::tagOf<std::string>:                               return visitor(v.ref<std::string>());
+    case Value::tagOf<Color>:                                     return visitor(v.ref<Color>());
+    case Value::tagOf<std::shared_ptr<ObjFunction>>:              return visitor(v.ref<std::shared_ptr<ObjFunction>>());
+    case Value::tagOf<std::shared_ptr<ObjClass>>:                 return visitor(v.ref<std::shared_ptr<ObjClass>>());
+    case Value::tagOf<std::shared_ptr<ObjInstance>>:              return visitor(v.ref<std::shared_ptr<ObjInstance>>());
+    case Value::tagOf<std::shared_ptr<ObjArray>>:                 return visitor(v.ref<std::shared_ptr<ObjArray>>());
+    case Value::tagOf<std::shared_ptr<ObjBoundMethod>>:           return visitor(v.ref<std::shared_ptr<ObjBoundMethod>>());
+    case Value::tagOf<BuiltinFn>:                                 return visitor(v.ref<BuiltinFn>());
+    case Value::tagOf<PropertiesType>:                            return visitor(v.ref<PropertiesType>());
+    case Value::tagOf<std::vector<std::shared_ptr<ObjFunction>>>: return visitor(v.ref<std::vector<std::shared_ptr<ObjFunction>>>());
+    case Value::tagOf<std::shared_ptr<ObjModule>>:                return visitor(v.ref<std::shared_ptr<ObjModule>>());
+    case Value::tagOf<std::shared_ptr<ObjEnum>>:                  return visitor(v.ref<std::shared_ptr<ObjEnum>>());
+    case Value::tagOf<std::shared_ptr<ObjRef>>:                   return visitor(v.ref<std::shared_ptr<ObjRef>>());
+    case Value::tagOf<void*>:                                     return visitor(v.ref<void*>());
+    case Value::tagOf<std::shared_ptr<ObjDictionary>>:            return visitor(v.ref<std::shared_ptr<ObjDictionary>>());
+    default:                                                      return visitor(std::monostate{});
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Read-only view of a builtin's arguments: a pointer and a count. The VM
+// passes the arguments where they already sit on its stack, so calling a
+// builtin copies nothing; host code can pass a vector or a named array.
+// A view into vm.stack stays valid while the builtin runs, even if it calls
+// back into the VM, as long as the stack stays within its STACK_MAX
+// reservation: pushFrame and runFunction check for headroom before a call.
+// ----------------------------------------------------------------------------
+struct ArgSpan {
+    const Value* first = nullptr;
+    size_t count = 0;
+
+    ArgSpan() = default;
+    ArgSpan(const Value* data, size_t n) : first(data), count(n) {}
+    ArgSpan(const std::vector<Value>& v) : first(v.data()), count(v.size()) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Value* data() const { return first; }
+    const Value* begin() const { return first; }
+    const Value* end() const { return first + count; }
+    const Value& operator[](size_t i) const { return first[i]; }
+    const Value& front() const { return first[0]; }
+    const Value& back() const { return first[count - 1]; }
 };
 
 
@@ -195,29 +443,90 @@ struct CallbackRequest {
     std::string param;
 };
 
-std::queue<CallbackRequest> callbackQueue;
-std::mutex callbackQueueMutex;
+// ---------------------------------------------------------------------------
+//  CallbackQueue – intrusive multi-producer / single-consumer queue (Vyukov).
+//  Plugin threads push without taking a lock; only the main thread pops.
+// ---------------------------------------------------------------------------
+class CallbackQueue {
+public:
+    CallbackQueue() : head(&stub), tail(&stub) {}
+
+    ~CallbackQueue() {
+        CallbackRequest req;
+        while (pop(req)) {}
+    }
+
+    // Safe to call from any thread.
+    void push(CallbackRequest req) {
+        Node* n = new Node;
+        n->req = std::move(req);
+        pushNode(n);
+    }
+
+    // Main thread only. Returns false when empty (or when a producer is
+    // mid-push; the item will be seen on the next drain).
+    bool pop(CallbackRequest& out) {
+        Node* t = tail;
+        Node* next = t->next.load(std::memory_order_acquire);
+        if (t == &stub) {
+            if (!next) return false;
+            tail = next;
+            t = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            out = std::move(t->req);
+            delete t;
+            return true;
+        }
+        if (t != head.load(std::memory_order_acquire))
+            return false;
+        pushNode(&stub);
+        next = t->next.load(std::memory_order_acquire);
+        if (!next) return false;
+        tail = next;
+        out = std::move(t->req);
+        delete t;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{ nullptr };
+        CallbackRequest req;
+    };
+
+    void pushNode(Node* n) {
+        n->next.store(nullptr, std::memory_order_relaxed);
+        Node* prev = head.exchange(n, std::memory_order_acq_rel);
+        prev->next.store(n, std::memory_order_release);
+    }
+
+    Node stub;
+    std::atomic<Node*> head;
+    Node* tail;
+};
+
+CallbackQueue callbackQueue;
+// Number of queued-but-not-yet-run callbacks; lets the VM skip the queue
+// entirely with a single relaxed load when nothing is pending.
+std::atomic<unsigned> pendingCallbacks{ 0 };
 
 std::thread::id mainThreadId;
 
 // ---------------------------------------------------------------------------
 //  processPendingCallbacks   – Drain queue without blocking the VM (non-blocking main thread/threads)
+//  Called by the VM only at safepoints (backward jumps, calls, returns).
 // ---------------------------------------------------------------------------
 void processPendingCallbacks()
 {
-    for (;;) {
-        CallbackRequest req;
+    if (pendingCallbacks.load(std::memory_order_relaxed) == 0)
+        return;
 
-        // 1) Grab one pending callback under the lock
-        {
-            std::lock_guard<std::mutex> lk(callbackQueueMutex);
-            if (callbackQueue.empty())
-                break;                // nothing to do
-            req = std::move(callbackQueue.front());
-            callbackQueue.pop();
-        }   // <-- mutex released here
-
-        // 2) Now it’s safe to run script code
+    CallbackRequest req;
+    while (callbackQueue.pop(req)) {
+        pendingCallbacks.fetch_sub(1, std::memory_order_relaxed);
         invokeScriptCallback(req.funcVal, req.param.c_str());
     }
 }
@@ -228,11 +537,16 @@ void processPendingCallbacks()
 // ----------------------------------------------------------------------------
 template<typename T>
 bool holds(const Value& v) {
-    return std::holds_alternative<T>(v); 
+    return v.is<T>();
 }
 template<typename T>
 T getVal(const Value& v) {
-    return std::get<T>(v);
+    return v.ref<T>();
+}
+// Reference access without the copy getVal makes.
+template<typename T>
+const T& valueRef(const Value& v) {
+    return v.ref<T>();
 }
 template <typename T>
 std::string getTypeName(const T& var) {
@@ -248,6 +562,74 @@ std::string toLower(const std::string& s) {
     return ret;
 }
 
+// ============================================================================  
+// Symbols – interned, case-folded identifiers
+// Names are case-insensitive, so every spelling of a name maps to one integer
+// ID. The compiler interns the names it emits; environments, class methods,
+// fields, module members and extension tables are keyed on the ID, so the VM
+// compares integers instead of lower-casing strings on every access.
+// ============================================================================
+using Symbol = uint32_t;
+
+class SymbolTable {
+public:
+    // Each spelling seen is remembered, so only its first lookup folds case.
+    Symbol intern(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end())
+            return it->second;
+        std::string folded = toLower(name);
+        Symbol id;
+        auto fit = ids.find(folded);
+        if (fit != ids.end()) {
+            id = fit->second;
+        } else {
+            id = static_cast<Symbol>(names.size());
+            names.push_back(folded);
+            ids.emplace(folded, id);
+        }
+        ids.emplace(name, id);
+        return id;
+    }
+
+    // The lower-case name.
+    const std::string& name(Symbol id) const { return names[id]; }
+
+private:
+    std::unordered_map<std::string, Symbol> ids;
+    std::deque<std::string> names; // stable references for name()
+};
+
+SymbolTable& symbolTable() {
+    static SymbolTable table;
+    return table;
+}
+
+inline Symbol intern(const std::string& name) { return symbolTable().intern(name); }
+inline const std::string& symbolName(Symbol id) { return symbolTable().name(id); }
+
+// Built-in array and Dictionary method names, interned at startup so their
+// dispatchers compare symbols rather than strings.
+static const Symbol SYM_ADD       = intern("add");
+static const Symbol SYM_INDEXOF   = intern("indexof");
+static const Symbol SYM_LASTINDEX = intern("lastindex");
+static const Symbol SYM_COUNT     = intern("count");
+static const Symbol SYM_JOIN      = intern("join");
+static const Symbol SYM_POP       = intern("pop");
+static const Symbol SYM_REMOVEAT  = intern("removeat");
+static const Symbol SYM_REMOVEALL = intern("removeall");
+static const Symbol SYM_VALUE     = intern("value");
+static const Symbol SYM_LOOKUP    = intern("lookup");
+static const Symbol SYM_HASKEY    = intern("haskey");
+static const Symbol SYM_REMOVE    = intern("remove");
+static const Symbol SYM_CLEAR     = intern("clear");
+static const Symbol SYM_KEYCOUNT  = intern("keycount");
+static const Symbol SYM_KEYS      = intern("keys");
+static const Symbol SYM_VALUES    = intern("values");
+static const Symbol SYM_KEY       = intern("key");
+static const Symbol SYM_RESERVE   = intern("reserve");
+static const Symbol SYM_TOSTRING  = intern("tostring");
+
 // ============================================================================  
 // Parameter structure for functions/methods
 // ============================================================================
@@ -268,43 +650,605 @@ enum class AccessModifier { PUBLIC, PRIVATE };
 // ============================================================================  
 // Object definitions
 // ============================================================================
+
+// ----------------------------------------------------------------------------
+// Inline cache for one OP_GET_PROPERTY / OP_SET_PROPERTY / OP_INVOKE site. Entries are
+// keyed on the receiver's class (held, so the address can't be reused) and
+// remember how the name resolved for instances of that class. Up to
+// PropertyCache::WAYS classes are cached; past that the site goes megamorphic
+// and always takes the slow path.
+// ----------------------------------------------------------------------------
+struct PropertyCache {
+    enum Kind : uint8_t {
+        FIELD,          // declared instance field (shape slot)
+        PLUGIN_GETTER,  // plugin property getter
+        PLUGIN_SETTER,  // plugin property setter
+        METHOD,         // scripted method (GET pushes a bound method, INVOKE calls it)
+        PLUGIN_METHOD   // plugin method (GET pushes a handle-bound builtin)
+    };
+    struct Entry {
+        std::shared_ptr<ObjClass> klass;
+        Kind kind = FIELD;
+        int slot = -1;                       // FIELD
+        const BuiltinFn* accessor = nullptr; // PLUGIN_GETTER / PLUGIN_SETTER
+        Value method;                        // METHOD / PLUGIN_METHOD
+    };
+    static const int WAYS = 4;
+
+    Entry entries[WAYS];
+    int count = 0;
+    bool megamorphic = false;
+
+    const Entry* find(const ObjClass* klass) const {
+        for (int i = 0; i < count; i++)
+            if (entries[i].klass.get() == klass)
+                return &entries[i];
+        return nullptr;
+    }
+
+    void record(const std::shared_ptr<ObjClass>& klass, Kind kind, int slot = -1,
+                const BuiltinFn* accessor = nullptr, const Value& method = Value()) {
+        if (megamorphic || !klass || find(klass.get()))
+            return;
+        if (count == WAYS) {
+            megamorphic = true;
+            return;
+        }
+        entries[count].klass    = klass;
+        entries[count].kind     = kind;
+        entries[count].slot     = slot;
+        entries[count].accessor = accessor;
+        entries[count].method   = method;
+        count++;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Jump table for one OP_SWITCH site: a Select Case whose Case values are all
+// Integer (or Enum member) constants, or all String constants. Integer keys
+// close enough together go in a dense vector indexed from `low`, the rest in a
+// hash map. Matching follows OP_EQ: a Double selector finds the Integer case
+// it is numerically equal to, and a selector of any other type falls through
+// to the default target (Case Else, or the end of the Select).
+// ----------------------------------------------------------------------------
+struct SwitchTable {
+    int defaultTarget = 0;
+    int low = 0;
+    std::vector<int> dense; // target per value from `low`, -1 where no Case
+    std::unordered_map<int, int> sparse;
+    std::unordered_map<std::string, int> strings;
+
+    int intTarget(int key) const {
+        if (!dense.empty()) {
+            long long i = (long long)key - low;
+            if (i >= 0 && i < (long long)dense.size() && dense[(size_t)i] >= 0)
+                return dense[(size_t)i];
+            return defaultTarget;
+        }
+        auto it = sparse.find(key);
+        return (it != sparse.end()) ? it->second : defaultTarget;
+    }
+
+    int targetFor(const Value& selector) const {
+        if (holds<int>(selector))
+            return intTarget(valueRef<int>(selector));
+        if (holds<double>(selector)) {
+            double d = valueRef<double>(selector);
+            if (d >= std::numeric_limits<int>::min() && d <= std::numeric_limits<int>::max() &&
+                d == (double)(int)d)
+                return intTarget((int)d);
+            return defaultTarget;
+        }
+        if (holds<std::string>(selector)) {
+            auto it = strings.find(valueRef<std::string>(selector));
+            return (it != strings.end()) ? it->second : defaultTarget;
+        }
+        return defaultTarget;
+    }
+};
+
 struct ObjFunction {
     std::string name;
     int arity = 0; // Parameter initialization.
     std::vector<Param> params; // Full parameter list
+    int localCount = 0; // Slots needed per call: self (methods), parameters, then Dim'd locals
+    bool hasReceiver = false; // Slot 0 holds self (class methods) or the Extends receiver
+    bool isMethod = false;    // Class method: unresolved names fall back to self's fields
     struct CodeChunk {
-        std::vector<int> code;
+        std::vector<uint8_t> code;      // see "Instruction encoding" below
         std::vector<Value> constants;
+        std::vector<PropertyCache> propertyCaches; // indexed by GET/SET_PROPERTY's 2nd operand
+        std::vector<SwitchTable> switchTables;     // indexed by OP_SWITCH's operand
+        std::unordered_map<std::string, int> constantIndex; // compile time: pooled constant -> slot
     } chunk;
 };
 
+// ----------------------------------------------------------------------------
+// Shape – the fixed field layout shared by every instance of a class. Each
+// declared property gets a slot (a redeclared name keeps its first slot and
+// takes the last default). Built once, on first use, from
+// ObjClass::properties; see classShape().
+// ----------------------------------------------------------------------------
+struct Shape {
+    std::unordered_map<Symbol, int> slotBySymbol;
+    std::vector<Value> defaults; // initial slot values for new instances
+
+    int slotOf(Symbol name) const {
+        auto it = slotBySymbol.find(name);
+        return (it != slotBySymbol.end()) ? it->second : -1;
+    }
+};
+
 struct ObjClass {
     std::string name;
-    std::unordered_map<std::string, Value> methods;
+    std::unordered_map<Symbol, Value> methods;
     PropertiesType properties;
     bool isPlugin = false;
     BuiltinFn pluginConstructor;
-    std::unordered_map<std::string, std::pair<BuiltinFn, BuiltinFn>> pluginProperties;
+    std::unordered_map<Symbol, std::pair<BuiltinFn, BuiltinFn>> pluginProperties;
+    std::unique_ptr<Shape> shape; // built lazily by classShape()
+    // Built-in container classes (Dictionary): New returns this factory's
+    // result instead of an ObjInstance.
+    BuiltinFn nativeFactory;
 };
 
+const Shape& classShape(ObjClass& cls) {
+    if (!cls.shape) {
+        auto shape = std::make_unique<Shape>();
+        for (auto& p : cls.properties) {
+            Symbol name = intern(p.first);
+            auto it = shape->slotBySymbol.find(name);
+            if (it != shape->slotBySymbol.end()) {
+                shape->defaults[it->second] = p.second;
+            } else {
+                shape->slotBySymbol[name] = (int)shape->defaults.size();
+                shape->defaults.push_back(p.second);
+            }
+        }
+        cls.shape = std::move(shape);
+    }
+    return *cls.shape;
+}
+
+// Instances keep declared fields in a flat slot vector laid out by the class
+// shape. Fields added at runtime (OP_SET_PROPERTY on an undeclared name) go
+// to a per-instance dictionary that only exists once one is added.
 struct ObjInstance {
     std::shared_ptr<ObjClass> klass;
-    std::unordered_map<std::string, Value> fields;
+    std::vector<Value> slots;
+    std::unique_ptr<std::unordered_map<Symbol, Value>> extraFields;
     void* pluginInstance = nullptr;
+
+    // Gives a new instance its class's declared fields and defaults.
+    void initFields() {
+        slots = classShape(*klass).defaults;
+    }
+
+    Value* findField(Symbol name) {
+        int slot = klass->shape ? klass->shape->slotOf(name) : -1;
+        if (slot >= 0 && slot < (int)slots.size())
+            return &slots[slot];
+        if (extraFields) {
+            auto it = extraFields->find(name);
+            if (it != extraFields->end())
+                return &it->second;
+        }
+        return nullptr;
+    }
+
+    // Like findField, but adds a dictionary field when the name is new.
+    Value& fieldRef(Symbol name) {
+        if (Value* cell = findField(name))
+            return *cell;
+        if (!extraFields)
+            extraFields = std::make_unique<std::unordered_map<Symbol, Value>>();
+        return (*extraFields)[name];
+    }
+
+    bool hasExtraField(Symbol name) const {
+        return extraFields && extraFields->count(name);
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Value equality for Array.IndexOf and the array lookup table: Integer and
+// Double compare numerically, strings/booleans/colors by content, and
+// objects by identity. valueHash is consistent with it.
+// ----------------------------------------------------------------------------
+static const void* objectIdentity(const Value& v)
+{
+    if (holds<std::shared_ptr<ObjInstance>>(v))    return valueRef<std::shared_ptr<ObjInstance>>(v).get();
+    if (holds<std::shared_ptr<ObjArray>>(v))       return valueRef<std::shared_ptr<ObjArray>>(v).get();
+    if (holds<std::shared_ptr<ObjDictionary>>(v))  return valueRef<std::shared_ptr<ObjDictionary>>(v).get();
+    if (holds<std::shared_ptr<ObjClass>>(v))       return valueRef<std::shared_ptr<ObjClass>>(v).get();
+    if (holds<std::shared_ptr<ObjFunction>>(v))    return valueRef<std::shared_ptr<ObjFunction>>(v).get();
+    if (holds<std::shared_ptr<ObjBoundMethod>>(v)) return valueRef<std::shared_ptr<ObjBoundMethod>>(v).get();
+    if (holds<std::shared_ptr<ObjModule>>(v))      return valueRef<std::shared_ptr<ObjModule>>(v).get();
+    if (holds<std::shared_ptr<ObjEnum>>(v))        return valueRef<std::shared_ptr<ObjEnum>>(v).get();
+    if (holds<std::shared_ptr<ObjRef>>(v))         return valueRef<std::shared_ptr<ObjRef>>(v).get();
+    if (holds<void*>(v))                           return getVal<void*>(v);
+    return nullptr;
+}
+
+static bool valuesEqual(const Value& a, const Value& b)
+{
+    if (holds<int>(a) && holds<int>(b))
+        return getVal<int>(a) == getVal<int>(b);
+    const bool aNum = holds<int>(a) || holds<double>(a);
+    const bool bNum = holds<int>(b) || holds<double>(b);
+    if (aNum || bNum) {
+        if (!aNum || !bNum) return false;
+        double ad = holds<double>(a) ? getVal<double>(a) : static_cast<double>(getVal<int>(a));
+        double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
+        return ad == bd;
+    }
+    if (a.index() != b.index())
+        return false;
+    if (holds<std::monostate>(a)) return true;
+    if (holds<bool>(a))           return getVal<bool>(a) == getVal<bool>(b);
+    if (holds<std::string>(a))    return valueRef<std::string>(a) == valueRef<std::string>(b);
+    if (holds<Color>(a))          return getVal<Color>(a).value == getVal<Color>(b).value;
+    const void* ida = objectIdentity(a);
+    return ida && ida == objectIdentity(b);
+}
+
+static size_t rawValueHash(const Value& v)
+{
+    if (holds<int>(v) || holds<double>(v)) {
+        double d = holds<double>(v) ? getVal<double>(v) : static_cast<double>(getVal<int>(v));
+        return std::hash<double>()(d == 0.0 ? 0.0 : d);   // 0.0 == -0.0
+    }
+    if (holds<bool>(v))        return std::hash<bool>()(getVal<bool>(v));
+    if (holds<std::string>(v)) return std::hash<std::string>()(valueRef<std::string>(v));
+    if (holds<Color>(v))       return std::hash<unsigned int>()(getVal<Color>(v).value);
+    return std::hash<const void*>()(objectIdentity(v));
+}
+
+// std::hash is the identity for pointers (and small integers) in common
+// standard libraries, and aligned heap addresses only differ in their upper
+// bits. Tables that index with `h & mask` need every bit mixed in, so the
+// raw hash goes through the MurmurHash3 finaliser.
+static size_t valueHash(const Value& v)
+{
+    uint64_t h = rawValueHash(v);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+struct ValueHasher {
+    size_t operator()(const Value& v) const { return valueHash(v); }
+};
+struct ValueEquals {
+    bool operator()(const Value& a, const Value& b) const { return valuesEqual(a, b); }
 };
 
+// Arrays declared `Dim a() As Integer/Double/Boolean` keep their elements
+// unboxed in ints/doubles/bools. The first store of any other type moves
+// everything into `elements` for good (promote()), so a typed array behaves
+// exactly like a generic one – it is only stored more compactly. Read and
+// write elements through size/get/set/append/... rather than `elements`.
 struct ObjArray {
-    std::vector<Value> elements;
+    enum class Storage : uint8_t { VALUES, INTS, DOUBLES, BOOLS };
+
+    std::vector<Value> elements;       // Storage::VALUES
+    Storage storage = Storage::VALUES;
+    std::vector<int> ints;             // Storage::INTS
+    std::vector<double> doubles;       // Storage::DOUBLES
+    std::vector<uint8_t> bools;        // Storage::BOOLS
+
+    // Element -> first position, built by IndexOf once the array is searched
+    // repeatedly. append/removeLast keep it current; every other change
+    // drops it through invalidate().
+    std::unique_ptr<std::unordered_map<Value, int, ValueHasher, ValueEquals>> positions;
+    int searchesSinceChange = 0;
+
+    ObjArray() = default;
+    explicit ObjArray(Storage s) : storage(s) {}
+
+    // Storage for `Dim a() As <typeName>`.
+    static Storage storageFor(const std::string& typeName) {
+        if (typeName == "integer") return Storage::INTS;
+        if (typeName == "double")  return Storage::DOUBLES;
+        if (typeName == "boolean") return Storage::BOOLS;
+        return Storage::VALUES;
+    }
+
+    size_t size() const {
+        switch (storage) {
+        case Storage::INTS:    return ints.size();
+        case Storage::DOUBLES: return doubles.size();
+        case Storage::BOOLS:   return bools.size();
+        default:               return elements.size();
+        }
+    }
+    bool empty() const { return size() == 0; }
+
+    Value get(size_t i) const {
+        switch (storage) {
+        case Storage::INTS:    return ints[i];
+        case Storage::DOUBLES: return doubles[i];
+        case Storage::BOOLS:   return bools[i] != 0;
+        default:               return elements[i];
+        }
+    }
+
+    // Whether v can be stored without leaving typed storage.
+    bool accepts(const Value& v) const {
+        switch (storage) {
+        case Storage::INTS:    return holds<int>(v);
+        case Storage::DOUBLES: return holds<double>(v);
+        case Storage::BOOLS:   return holds<bool>(v);
+        default:               return true;
+        }
+    }
+
+    void promote() {
+        if (storage == Storage::VALUES)
+            return;
+        size_t n = size();
+        elements.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            elements.push_back(get(i));
+        storage = Storage::VALUES;
+        std::vector<int>().swap(ints);
+        std::vector<double>().swap(doubles);
+        std::vector<uint8_t>().swap(bools);
+    }
+
+    void set(size_t i, const Value& v) {
+        if (!accepts(v))
+            promote();
+        switch (storage) {
+        case Storage::INTS:    ints[i] = getVal<int>(v); break;
+        case Storage::DOUBLES: doubles[i] = getVal<double>(v); break;
+        case Storage::BOOLS:   bools[i] = getVal<bool>(v); break;
+        default:               elements[i] = v; break;
+        }
+        invalidate();
+    }
+
+    void append(const Value& v) {
+        if (!accepts(v))
+            promote();
+        switch (storage) {
+        case Storage::INTS:    ints.push_back(getVal<int>(v)); break;
+        case Storage::DOUBLES: doubles.push_back(getVal<double>(v)); break;
+        case Storage::BOOLS:   bools.push_back(getVal<bool>(v)); break;
+        default:               elements.push_back(v); break;
+        }
+        if (positions)
+            positions->emplace(v, (int)size() - 1);
+    }
+
+    Value removeLast() {
+        Value last = get(size() - 1);
+        switch (storage) {
+        case Storage::INTS:    ints.pop_back(); break;
+        case Storage::DOUBLES: doubles.pop_back(); break;
+        case Storage::BOOLS:   bools.pop_back(); break;
+        default:               elements.pop_back(); break;
+        }
+        if (positions) {
+            auto it = positions->find(last);
+            if (it != positions->end() && it->second == (int)size())
+                positions->erase(it);
+        }
+        return last;
+    }
+
+    void removeAt(size_t i) {
+        switch (storage) {
+        case Storage::INTS:    ints.erase(ints.begin() + i); break;
+        case Storage::DOUBLES: doubles.erase(doubles.begin() + i); break;
+        case Storage::BOOLS:   bools.erase(bools.begin() + i); break;
+        default:               elements.erase(elements.begin() + i); break;
+        }
+        invalidate();
+    }
+
+    void clear() {
+        elements.clear();
+        ints.clear();
+        doubles.clear();
+        bools.clear();
+        invalidate();
+    }
+
+    // Grows to n elements; the new ones are nil, which only generic
+    // storage can hold.
+    void growTo(size_t n) {
+        if (n <= size())
+            return;
+        promote();
+        elements.resize(n, Value(std::monostate{}));
+        invalidate();
+    }
+
+    // Replaces the contents, keeping typed storage when every value fits.
+    void assign(std::vector<Value> values) {
+        clear();
+        for (auto& v : values)
+            if (!accepts(v)) {
+                promote();
+                break;
+            }
+        if (storage == Storage::VALUES) {
+            elements = std::move(values);
+            return;
+        }
+        for (auto& v : values)
+            append(v);
+    }
+
+    void invalidate() {
+        positions.reset();
+        searchesSinceChange = 0;
+    }
+
+    int indexOf(const Value& probe) {
+        size_t n = size();
+        // A single search is cheaper as a scan than building the table.
+        if (!positions && (n < 16 || ++searchesSinceChange < 2)) {
+            if (storage == Storage::INTS && holds<int>(probe)) {
+                auto it = std::find(ints.begin(), ints.end(), getVal<int>(probe));
+                return it != ints.end() ? (int)(it - ints.begin()) : -1;
+            }
+            if (storage == Storage::DOUBLES && holds<double>(probe)) {
+                auto it = std::find(doubles.begin(), doubles.end(), getVal<double>(probe));
+                return it != doubles.end() ? (int)(it - doubles.begin()) : -1;
+            }
+            for (size_t i = 0; i < n; ++i)
+                if (valuesEqual(get(i), probe))
+                    return (int)i;
+            return -1;
+        }
+        if (!positions) {
+            positions = std::make_unique<std::unordered_map<Value, int, ValueHasher, ValueEquals>>();
+            positions->reserve(n);
+            for (size_t i = 0; i < n; ++i)
+                positions->emplace(get(i), (int)i);
+        }
+        auto it = positions->find(probe);
+        return it != positions->end() ? it->second : -1;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Dictionary – keys and values are any Value, compared with valuesEqual.
+// Entries are stored densely in insertion order (so Keys/Values/Key(i)
+// enumerate in that order); `buckets` is an open-addressing table of entry
+// positions with linear probing. Remove leaves a hole in `entries` and a
+// tombstone in `buckets`; both are swept out when the table is rebuilt.
+// ----------------------------------------------------------------------------
+struct ObjDictionary {
+    struct Entry {
+        Value key;
+        Value value;
+        size_t hash;
+        bool live;
+    };
+    static constexpr int32_t EMPTY = -1;
+    static constexpr int32_t TOMBSTONE = -2;
+
+    std::vector<Entry> entries;
+    std::vector<int32_t> buckets;   // size is zero or a power of two
+    size_t liveCount = 0;
+
+    size_t count() const { return liveCount; }
+
+    // Position of key in entries, or -1.
+    int find(const Value& key) const {
+        if (buckets.empty())
+            return -1;
+        size_t h = valueHash(key);
+        size_t mask = buckets.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            int32_t b = buckets[i];
+            if (b == EMPTY)
+                return -1;
+            if (b >= 0 && entries[b].hash == h && valuesEqual(entries[b].key, key))
+                return b;
+        }
+    }
+
+    Value* lookup(const Value& key) {
+        int at = find(key);
+        return at >= 0 ? &entries[at].value : nullptr;
+    }
+
+    void set(const Value& key, const Value& value) {
+        int at = find(key);
+        if (at >= 0) {
+            entries[at].value = value;
+            return;
+        }
+        // Holes count toward the load factor, so probes always end.
+        if ((entries.size() + 1) * 4 > buckets.size() * 3)
+            rebuild((liveCount + 1) * 2);
+        size_t h = valueHash(key);
+        entries.push_back({ key, value, h, true });
+        place(h, (int32_t)entries.size() - 1);
+        ++liveCount;
+    }
+
+    bool remove(const Value& key) {
+        int at = find(key);
+        if (at < 0)
+            return false;
+        size_t mask = buckets.size() - 1;
+        for (size_t i = entries[at].hash & mask;; i = (i + 1) & mask) {
+            if (buckets[i] == at) {
+                buckets[i] = TOMBSTONE;
+                break;
+            }
+        }
+        entries[at] = { Value(), Value(), 0, false };
+        --liveCount;
+        if (liveCount == 0)
+            clear();
+        return true;
+    }
+
+    void clear() {
+        entries.clear();
+        std::fill(buckets.begin(), buckets.end(), EMPTY);
+        liveCount = 0;
+    }
+
+    // Sizes the table for n entries without further rehashing.
+    void reserve(size_t n) {
+        if (n > liveCount && n * 4 > buckets.size() * 3)
+            rebuild(n);
+        entries.reserve(n);
+    }
+
+    // The i-th live entry in insertion order.
+    Entry& entryAt(size_t i) {
+        if (liveCount != entries.size())
+            rebuild(buckets.size() * 3 / 4);
+        return entries[i];
+    }
+
+private:
+    void place(size_t h, int32_t index) {
+        size_t mask = buckets.size() - 1;
+        size_t i = h & mask;
+        while (buckets[i] >= 0)
+            i = (i + 1) & mask;
+        buckets[i] = index;
+    }
+
+    // Drops removed entries and rehashes into a table that holds `capacity`
+    // entries at no more than 3/4 load.
+    void rebuild(size_t capacity) {
+        if (liveCount != entries.size()) {
+            size_t out = 0;
+            for (size_t i = 0; i < entries.size(); ++i)
+                if (entries[i].live)
+                    entries[out++] = std::move(entries[i]);
+            entries.resize(out);
+        }
+        size_t size = 8;
+        while (size * 3 < capacity * 4)
+            size *= 2;
+        buckets.assign(size, EMPTY);
+        for (size_t i = 0; i < entries.size(); ++i)
+            place(entries[i].hash, (int32_t)i);
+    }
 };
 
 struct ObjBoundMethod {
     Value receiver;
-    std::string name;
+    Symbol name;
 };
 
 struct ObjModule {
     std::string name;
-    std::unordered_map<std::string, Value> publicMembers;
+    std::unordered_map<Symbol, Value> publicMembers;
 };
 
 // ============================================================================  
@@ -336,14 +1280,15 @@ std::string valueToString(const Value& val) {
         std::string operator()(const std::shared_ptr<ObjFunction>& fn) const { return "<function " + fn->name + ">"; }
         std::string operator()(const std::shared_ptr<ObjClass>& cls) const { return "<class " + cls->name + ">"; }
         std::string operator()(const std::shared_ptr<ObjInstance>& inst) const { return "<instance of " + inst->klass->name + ">"; }
-        std::string operator()(const std::shared_ptr<ObjArray>& arr) const { return "Array(" + std::to_string(arr->elements.size()) + ")"; }
-        std::string operator()(const std::shared_ptr<ObjBoundMethod>& bm) const { return "<bound method " + bm->name + ">"; }
+        std::string operator()(const std::shared_ptr<ObjArray>& arr) const { return "Array(" + std::to_string(arr->size()) + ")"; }
+        std::string operator()(const std::shared_ptr<ObjBoundMethod>& bm) const { return "<bound method " + symbolName(bm->name) + ">"; }
         std::string operator()(const BuiltinFn&) const { return "<builtin fn>"; }
         std::string operator()(const PropertiesType&) const { return "<properties>"; }
         std::string operator()(const std::vector<std::shared_ptr<ObjFunction>>&) const { return "<overloaded functions>"; }
         std::string operator()(const std::shared_ptr<ObjModule>& mod) const { return "<module " + mod->name + ">"; }
         std::string operator()(const std::shared_ptr<ObjEnum>& e) const { return "<enum " + e->name + ">"; }
         std::string operator()(const std::shared_ptr<ObjRef>&) const { return "<byref>"; }
+        std::string operator()(const std::shared_ptr<ObjDictionary>& dict) const { return "Dictionary(" + std::to_string(dict->count()) + ")"; }
         std::string operator()(void* ptr) const {
             if(ptr == nullptr) return "nil";
             char buf[20];
@@ -351,7 +1296,7 @@ std::string valueToString(const Value& val) {
             return std::string(buf);
         } // Pointer type
     } visitor;
-    return std::visit(visitor, val);
+    return visitValue(visitor, val);
 }
 
 // ============================================================================  
@@ -578,94 +1523,95 @@ std::string rtrim(const std::string& s) {
 // ============================================================================
 // Environment (case–insensitive for variable names)
 // Notes:
-//  - ByRef parameters are implemented by storing an ObjRef in the callee's environment.
+//  - Holds globals (and module scopes at compile time); function parameters
+//    and locals live in call-frame slots, see CallFrame below.
 //  - Environment::get() transparently dereferences ObjRef.
 //  - Environment::assign() writes through ObjRef.
 // ============================================================================
 [[noreturn]] void runtimeError(const std::string& msg);
 
 struct Environment {
-    std::unordered_map<std::string, Value> values;
+    std::unordered_map<Symbol, Value> values;
     std::shared_ptr<Environment> enclosing;
 
     Environment(std::shared_ptr<Environment> enclosing = nullptr)
         : enclosing(enclosing) { }
 
+    // Each accessor takes an interned name; the string overloads intern
+    // (and so case-fold) for host code.
+    void define(Symbol name, const Value& value) {
+        values[name] = value;
+    }
     void define(const std::string& name, const Value& value) {
-        values[toLower(name)] = value;
+        define(intern(name), value);
     }
 
     // Non-fatal lookup used by the compiler and a few runtime helpers.
-    bool tryGetRaw(const std::string& name, Value& out) const {
-        std::string key = toLower(name);
-        auto it = values.find(key);
-        if (it != values.end()) {
-            out = it->second;
-            return true;
+    bool tryGetRaw(Symbol name, Value& out) const {
+        for (const Environment* env = this; env; env = env->enclosing.get()) {
+            auto it = env->values.find(name);
+            if (it != env->values.end()) {
+                out = it->second;
+                return true;
+            }
         }
-        if (enclosing) return enclosing->tryGetRaw(name, out);
         return false;
     }
+    bool tryGetRaw(const std::string& name, Value& out) const {
+        return tryGetRaw(intern(name), out);
+    }
 
     // Return a pointer to the ultimate storage cell for a variable name.
     // If the variable is an ObjRef, this resolves and returns the referenced cell.
-    Value* getCell(const std::string& name) {
-        std::string key = toLower(name);
-
-        auto it = values.find(key);
-        if (it != values.end()) {
+    Value* getCell(Symbol name) {
+        for (Environment* env = this; env; env = env->enclosing.get()) {
+            auto it = env->values.find(name);
+            if (it == env->values.end())
+                continue;
             if (holds<std::shared_ptr<ObjRef>>(it->second)) {
                 auto r = getVal<std::shared_ptr<ObjRef>>(it->second);
                 if (!r || !r->target)
-                    runtimeError("ByRef: dangling reference for variable: " + name);
+                    runtimeError("ByRef: dangling reference for variable: " + symbolName(name));
                 return r->target;
             }
             return &it->second;
         }
 
-        // Support instance fields via implicit "self"
-        auto selfIt = values.find("self");
-        if (selfIt != values.end()) {
-            Value selfVal = selfIt->second;
-            if (holds<std::shared_ptr<ObjInstance>>(selfVal)) {
-                auto instance = getVal<std::shared_ptr<ObjInstance>>(selfVal);
-                auto fit = instance->fields.find(key);
-                if (fit != instance->fields.end())
-                    return &fit->second;
-            }
-        }
-
-        if (enclosing) return enclosing->getCell(name);
-
-        std::cerr << "NilObjectException for variable: " << name << std::endl;
+        std::cerr << "NilObjectException for variable: " << symbolName(name) << std::endl;
         exit(1);
         return nullptr;
     }
+    Value* getCell(const std::string& name) {
+        return getCell(intern(name));
+    }
 
     // Standard get: transparently dereference ObjRef.
-    Value get(const std::string& name) {
+    Value get(Symbol name) {
         Value* cell = getCell(name);
         if (!cell) return Value(std::monostate{});
         // If the cell itself happens to hold an ObjRef (nested), resolve once more.
         if (holds<std::shared_ptr<ObjRef>>(*cell)) {
             auto r = getVal<std::shared_ptr<ObjRef>>(*cell);
             if (!r || !r->target)
-                runtimeError("ByRef: dangling nested reference for variable: " + name);
+                runtimeError("ByRef: dangling nested reference for variable: " + symbolName(name));
             return *(r->target);
         }
         return *cell;
     }
+    Value get(const std::string& name) {
+        return get(intern(name));
+    }
 
     // Standard assign: write-through ObjRef when applicable.
-    void assign(const std::string& name, const Value& value) {
-        std::string key = toLower(name);
-
-        auto it = values.find(key);
-        if (it != values.end()) {
+    void assign(Symbol name, const Value& value) {
+        for (Environment* env = this; env; env = env->enclosing.get()) {
+            auto it = env->values.find(name);
+            if (it == env->values.end())
+                continue;
             if (holds<std::shared_ptr<ObjRef>>(it->second)) {
                 auto r = getVal<std::shared_ptr<ObjRef>>(it->second);
                 if (!r || !r->target)
-                    runtimeError("ByRef: dangling reference assignment for variable: " + name);
+                    runtimeError("ByRef: dangling reference assignment for variable: " + symbolName(name));
                 *(r->target) = value;
             } else {
                 it->second = value;
@@ -673,35 +1619,12 @@ struct Environment {
             return;
         }
 
-        // Support instance fields via implicit "self"
-        auto selfIt = values.find("self");
-        if (selfIt != values.end()) {
-            Value selfVal = selfIt->second;
-            if (holds<std::shared_ptr<ObjInstance>>(selfVal)) {
-                auto instance = getVal<std::shared_ptr<ObjInstance>>(selfVal);
-                auto fit = instance->fields.find(key);
-                if (fit != instance->fields.end()) {
-                    if (holds<std::shared_ptr<ObjRef>>(fit->second)) {
-                        auto r = getVal<std::shared_ptr<ObjRef>>(fit->second);
-                        if (!r || !r->target)
-                            runtimeError("ByRef: dangling field reference assignment for variable: " + name);
-                        *(r->target) = value;
-                    } else {
-                        fit->second = value;
-                    }
-                    return;
-                }
-            }
-        }
-
-        if (enclosing) {
-            enclosing->assign(name, value);
-            return;
-        }
-
-        std::cerr << "NilObjectException for variable: " << name << std::endl;
+        std::cerr << "NilObjectException for variable: " << symbolName(name) << std::endl;
         exit(1);
     }
+    void assign(const std::string& name, const Value& value) {
+        assign(intern(name), value);
+    }
 };
 
 
@@ -795,8 +1718,89 @@ enum OpCode {
     OP_DUP,
     OP_CONSTRUCTOR_END,
     // Unary NOT
-    OP_NOT
+    OP_NOT,
+    // Function locals resolved to slot indices at compile time
+    OP_GET_LOCAL,
+    OP_SET_LOCAL,
+    OP_DEFINE_LOCAL,
+    OP_GET_LOCAL_REF,
+    // Counted For/Next loop
+    OP_FOR_PREP,
+    OP_FOR_LOOP,
+    // receiver.name(args): method lookup and call in one step
+    OP_INVOKE,
+    // name = name + a + b ...: append the pieces to the variable in place
+    OP_APPEND_LOCAL,
+    OP_APPEND_GLOBAL,
+    // a(i) and a(i) = v where a is probably an array. Same operand (argc) as
+    // OP_CALL, which they rewrite themselves into when the callee isn't one.
+    OP_INDEX_GET,
+    OP_INDEX_SET,
+    // Select Case over constant Integer/String cases: pops the selector and
+    // jumps through the chunk's switch table named by the operand
+    OP_SWITCH,
+    // Short-circuit And/Or: jump, leaving the left operand as the result,
+    // when it is the Boolean that decides the outcome
+    OP_JUMP_IF_FALSE_KEEP,
+    OP_JUMP_IF_TRUE_KEEP,
+    // OP_SET_LOCAL/OP_SET_GLOBAL that leave the value on the stack; the
+    // peephole pass fuses a store and a load of the same variable into these
+    OP_SET_LOCAL_KEEP,
+    OP_SET_GLOBAL_KEEP,
+    // Return f(args): OP_CALL that hands a scripted callee this frame
+    OP_TAIL_CALL,
+    // Quickened forms of the arithmetic/comparison ops, written into the
+    // code by the VM once it has seen the operand types (never emitted)
+    OP_ADD_II,
+    OP_ADD_DD,
+    OP_CONCAT_SS,
+    OP_SUB_II,
+    OP_SUB_DD,
+    OP_MUL_II,
+    OP_MUL_DD,
+    OP_MOD_II,
+    OP_LT_II,
+    OP_LT_DD,
+    OP_LE_II,
+    OP_LE_DD,
+    OP_GT_II,
+    OP_GT_DD,
+    OP_GE_II,
+    OP_GE_DD,
+    OP_EQ_II,
+    OP_NE_II,
+    OP_COUNT // number of opcodes; keep last
 };
+static_assert(OP_COUNT <= 256, "opcodes are encoded in one byte");
+
+// ----------------------------------------------------------------------------
+// Instruction encoding: a one-byte opcode followed by its operand, if any.
+// Jump targets are a fixed 4-byte (native-endian) absolute offset so they can
+// be patched once the target is known; every other operand is unsigned
+// LEB128, which takes a single byte for values below 128. Operands that name
+// a global, property or method are Symbol IDs, not constant indices.
+// ----------------------------------------------------------------------------
+const int JUMP_OPERAND_SIZE = 4;
+
+inline int readOperand(const uint8_t* code, int& ip) {
+    int value = code[ip++];
+    if (value < 0x80)
+        return value;
+    value &= 0x7F;
+    for (int shift = 7;; shift += 7) {
+        uint8_t byte = code[ip++];
+        value |= (byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return value;
+    }
+}
+
+inline int readJumpTarget(const uint8_t* code, int& ip) {
+    uint32_t target;
+    std::memcpy(&target, code + ip, JUMP_OPERAND_SIZE);
+    ip += JUMP_OPERAND_SIZE;
+    return (int)target;
+}
 
 std::string opcodeToString(int opcode) {
     switch (opcode) {
@@ -839,10 +1843,307 @@ std::string opcodeToString(int opcode) {
     case OP_DUP:           return "OP_DUP";
     case OP_CONSTRUCTOR_END: return "OP_CONSTRUCTOR_END";
     case OP_NOT:           return "OP_NOT";
+    case OP_GET_LOCAL:     return "OP_GET_LOCAL";
+    case OP_SET_LOCAL:     return "OP_SET_LOCAL";
+    case OP_DEFINE_LOCAL:  return "OP_DEFINE_LOCAL";
+    case OP_GET_LOCAL_REF: return "OP_GET_LOCAL_REF";
+    case OP_FOR_PREP:      return "OP_FOR_PREP";
+    case OP_FOR_LOOP:      return "OP_FOR_LOOP";
+    case OP_INVOKE:        return "OP_INVOKE";
+    case OP_APPEND_LOCAL:  return "OP_APPEND_LOCAL";
+    case OP_APPEND_GLOBAL: return "OP_APPEND_GLOBAL";
+    case OP_INDEX_GET:     return "OP_INDEX_GET";
+    case OP_INDEX_SET:     return "OP_INDEX_SET";
+    case OP_SWITCH:        return "OP_SWITCH";
+    case OP_JUMP_IF_FALSE_KEEP: return "OP_JUMP_IF_FALSE_KEEP";
+    case OP_JUMP_IF_TRUE_KEEP:  return "OP_JUMP_IF_TRUE_KEEP";
+    case OP_SET_LOCAL_KEEP:     return "OP_SET_LOCAL_KEEP";
+    case OP_SET_GLOBAL_KEEP:    return "OP_SET_GLOBAL_KEEP";
+    case OP_TAIL_CALL:          return "OP_TAIL_CALL";
+    case OP_ADD_II:      return "OP_ADD_II";
+    case OP_ADD_DD:      return "OP_ADD_DD";
+    case OP_CONCAT_SS:   return "OP_CONCAT_SS";
+    case OP_SUB_II:      return "OP_SUB_II";
+    case OP_SUB_DD:      return "OP_SUB_DD";
+    case OP_MUL_II:      return "OP_MUL_II";
+    case OP_MUL_DD:      return "OP_MUL_DD";
+    case OP_MOD_II:      return "OP_MOD_II";
+    case OP_LT_II:       return "OP_LT_II";
+    case OP_LT_DD:       return "OP_LT_DD";
+    case OP_LE_II:       return "OP_LE_II";
+    case OP_LE_DD:       return "OP_LE_DD";
+    case OP_GT_II:       return "OP_GT_II";
+    case OP_GT_DD:       return "OP_GT_DD";
+    case OP_GE_II:       return "OP_GE_II";
+    case OP_GE_DD:       return "OP_GE_DD";
+    case OP_EQ_II:       return "OP_EQ_II";
+    case OP_NE_II:       return "OP_NE_II";
     default:               return "UNKNOWN";
     }
 }
 
+// Operand layout of an opcode: how many LEB128 operands follow it, and
+// whether a jump target comes after them.
+struct OpLayout {
+    int operands;
+    bool jump;
+};
+
+inline OpLayout opLayout(int opcode) {
+    switch (opcode) {
+    case OP_CONSTANT: case OP_DEFINE_GLOBAL: case OP_GET_GLOBAL: case OP_GET_REF:
+    case OP_SET_GLOBAL: case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_DEFINE_LOCAL:
+    case OP_GET_LOCAL_REF: case OP_CALL: case OP_OPTIONAL_CALL: case OP_INDEX_GET:
+    case OP_INDEX_SET: case OP_SWITCH: case OP_CLASS: case OP_METHOD: case OP_PROPERTIES:
+    case OP_SET_LOCAL_KEEP: case OP_SET_GLOBAL_KEEP: case OP_TAIL_CALL:
+        return { 1, false };
+    case OP_APPEND_LOCAL: case OP_APPEND_GLOBAL: case OP_ARRAY:
+    case OP_GET_PROPERTY: case OP_SET_PROPERTY:
+        return { 2, false };
+    case OP_INVOKE:
+        return { 3, false };
+    case OP_FOR_PREP:
+        return { 2, true };
+    case OP_FOR_LOOP:
+        return { 1, true };
+    case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_JUMP_IF_FALSE_KEEP: case OP_JUMP_IF_TRUE_KEEP:
+        return { 0, true };
+    default:
+        return { 0, false };
+    }
+}
+
+// ============================================================================  
+// Peephole optimizer (-O1 and up). Runs on each chunk once the compiler has
+// finished it:
+//  - jumps to an unconditional OP_JUMP go straight to its target, and an
+//    And/Or _KEEP jump landing on the same kind of jump takes that one's
+//    target too. A jump never changes direction, so every loop still closes
+//    with a backward OP_JUMP (the VM's safepoint);
+//  - OP_JUMP to the next instruction and OP_DUP; OP_POP pairs are dropped;
+//  - OP_SET_LOCAL/GLOBAL n; OP_GET_LOCAL/GLOBAL n become OP_SET_*_KEEP n;
+//  - code no path from the entry reaches (such as the OP_NIL; OP_RETURN
+//    after a final Return) is removed.
+// The chunk is then re-encoded with its jump targets and switch tables
+// remapped. Property caches keep their indices; a removed site's cache just
+// goes unused.
+// ============================================================================
+int OPTIMIZE_LEVEL = 0; // -O on the command line
+
+static void optimizeChunk(ObjFunction::CodeChunk& chunk) {
+    struct Instr {
+        int op;
+        int operands[3];
+        int target = -1; // instruction index, for jumps
+        bool dead = false;
+    };
+    const std::vector<uint8_t>& code = chunk.code;
+    std::vector<Instr> ins;
+    std::unordered_map<int, int> indexAt; // byte offset -> instruction index
+    std::vector<int> jumpOffsets;         // raw targets, resolved below
+    for (int ip = 0; ip < (int)code.size();) {
+        indexAt[ip] = (int)ins.size();
+        Instr in;
+        in.op = code[ip++];
+        OpLayout layout = opLayout(in.op);
+        for (int k = 0; k < layout.operands; k++)
+            in.operands[k] = readOperand(code.data(), ip);
+        jumpOffsets.push_back(layout.jump ? readJumpTarget(code.data(), ip) : -1);
+        ins.push_back(in);
+    }
+    const int n = (int)ins.size();
+    auto toIndex = [&](int offset, int& index) {
+        auto it = indexAt.find(offset);
+        if (it == indexAt.end())
+            return false;
+        index = it->second;
+        return true;
+    };
+    for (int i = 0; i < n; i++)
+        if (jumpOffsets[i] >= 0 && !toIndex(jumpOffsets[i], ins[i].target))
+            return; // not code this pass understands; leave it alone
+
+    // Switch table targets, as instruction indices, with the OP_SWITCH that owns each.
+    std::vector<std::pair<int, int*>> switchTargets;
+    std::vector<int> switchSite(chunk.switchTables.size(), -1);
+    for (int i = 0; i < n; i++)
+        if (ins[i].op == OP_SWITCH && ins[i].operands[0] < (int)switchSite.size())
+            switchSite[ins[i].operands[0]] = i;
+    for (size_t t = 0; t < chunk.switchTables.size(); t++) {
+        SwitchTable& table = chunk.switchTables[t];
+        if (switchSite[t] < 0)
+            return;
+        std::vector<int*> refs{ &table.defaultTarget };
+        for (int& d : table.dense)
+            if (d >= 0) refs.push_back(&d);
+        for (auto& e : table.sparse) refs.push_back(&e.second);
+        for (auto& e : table.strings) refs.push_back(&e.second);
+        for (int* r : refs) {
+            int index;
+            if (!toIndex(*r, index))
+                return;
+            switchTargets.emplace_back(switchSite[t], r);
+        }
+    }
+    for (auto& st : switchTargets)
+        toIndex(*st.second, *st.second);
+
+    // A target may name a removed instruction; control then reaches the next live one.
+    auto live = [&](int i) {
+        while (i < n && ins[i].dead) i++;
+        return i;
+    };
+    static const Symbol SYM_MICROSECONDS = intern("microseconds");
+    static const Symbol SYM_TICKS        = intern("ticks");
+
+    for (bool changed = true; changed;) {
+        changed = false;
+
+        // Jump threading.
+        auto thread = [&](int from, int& target, int op) {
+            for (int hops = 0; hops < 16; hops++) {
+                int j = live(target);
+                if (j >= n || j == from)
+                    return;
+                bool follow = ins[j].op == OP_JUMP ||
+                    ((op == OP_JUMP_IF_FALSE_KEEP || op == OP_JUMP_IF_TRUE_KEEP) && ins[j].op == op);
+                if (!follow || (ins[j].target <= from) != (target <= from))
+                    return;
+                target = ins[j].target;
+                changed = true;
+            }
+        };
+        for (int i = 0; i < n; i++)
+            if (!ins[i].dead && ins[i].target >= 0)
+                thread(i, ins[i].target, ins[i].op);
+        for (auto& st : switchTargets)
+            thread(st.first, *st.second, OP_SWITCH);
+
+        std::vector<bool> targeted(n + 1, false);
+        for (int i = 0; i < n; i++)
+            if (!ins[i].dead && ins[i].target >= 0)
+                targeted[live(ins[i].target)] = true;
+        for (auto& st : switchTargets)
+            targeted[live(*st.second)] = true;
+
+        // Local rewrites.
+        for (int i = live(0); i < n; i = live(i + 1)) {
+            Instr& in = ins[i];
+            int j = live(i + 1);
+            if (in.op == OP_JUMP && live(in.target) == j) {
+                in.dead = changed = true;
+                continue;
+            }
+            if (j >= n || targeted[j])
+                continue;
+            Instr& next = ins[j];
+            if (in.op == OP_DUP && next.op == OP_POP) {
+                in.dead = next.dead = changed = true;
+            }
+            else if (in.op == OP_SET_LOCAL && next.op == OP_GET_LOCAL && in.operands[0] == next.operands[0]) {
+                in.op = OP_SET_LOCAL_KEEP;
+                next.dead = changed = true;
+            }
+            else if (in.op == OP_SET_GLOBAL && next.op == OP_GET_GLOBAL && in.operands[0] == next.operands[0] &&
+                     (Symbol)in.operands[0] != SYM_MICROSECONDS && (Symbol)in.operands[0] != SYM_TICKS) {
+                in.op = OP_SET_GLOBAL_KEEP;
+                next.dead = changed = true;
+            }
+        }
+
+        // Unreachable code.
+        std::vector<bool> reached(n + 1, false);
+        std::vector<std::vector<int>> switchOut(n);
+        for (auto& st : switchTargets)
+            switchOut[st.first].push_back(*st.second);
+        std::vector<int> work{ live(0) };
+        while (!work.empty()) {
+            int i = work.back();
+            work.pop_back();
+            if (i >= n || reached[i])
+                continue;
+            reached[i] = true;
+            const Instr& in = ins[i];
+            if (in.target >= 0)
+                work.push_back(live(in.target));
+            for (int t : switchOut[i])
+                work.push_back(live(t));
+            if (in.op != OP_JUMP && in.op != OP_RETURN && in.op != OP_SWITCH)
+                work.push_back(live(i + 1));
+        }
+        for (int i = 0; i < n; i++)
+            if (!ins[i].dead && !reached[i])
+                ins[i].dead = changed = true;
+    }
+
+    // Re-encode. A removed instruction's offset is that of the next live one.
+    auto operandSize = [](int v) {
+        int size = 1;
+        for (unsigned u = (unsigned)v; u >= 0x80; u >>= 7) size++;
+        return size;
+    };
+    std::vector<int> newOffset(n + 1);
+    int offset = 0;
+    for (int i = 0; i < n; i++) {
+        newOffset[i] = offset;
+        if (ins[i].dead)
+            continue;
+        OpLayout layout = opLayout(ins[i].op);
+        offset += 1 + (layout.jump ? JUMP_OPERAND_SIZE : 0);
+        for (int k = 0; k < layout.operands; k++)
+            offset += operandSize(ins[i].operands[k]);
+    }
+    newOffset[n] = offset;
+
+    std::vector<uint8_t> out;
+    out.reserve(offset);
+    for (int i = 0; i < n; i++) {
+        if (ins[i].dead)
+            continue;
+        out.push_back((uint8_t)ins[i].op);
+        OpLayout layout = opLayout(ins[i].op);
+        for (int k = 0; k < layout.operands; k++) {
+            unsigned v = (unsigned)ins[i].operands[k];
+            while (v >= 0x80) {
+                out.push_back((uint8_t)((v & 0x7F) | 0x80));
+                v >>= 7;
+            }
+            out.push_back((uint8_t)v);
+        }
+        if (layout.jump) {
+            uint32_t t = (uint32_t)newOffset[ins[i].target];
+            size_t pos = out.size();
+            out.resize(pos + JUMP_OPERAND_SIZE);
+            std::memcpy(&out[pos], &t, JUMP_OPERAND_SIZE);
+        }
+    }
+    for (auto& st : switchTargets)
+        *st.second = newOffset[*st.second];
+    DEBUG_TRACE(TRACE_COMPILER, "Peephole: " + std::to_string(code.size()) + " -> " +
+        std::to_string(out.size()) + " bytes");
+    chunk.code = std::move(out);
+}
+
+// ============================================================================  
+// Call frames
+// Every scripted call gets a window of localCount slots in VM::slots (self
+// first for methods, then parameters, then Dim'd locals) and remembers the IP
+// to resume at in the caller. The frame, slot and value stacks are reserved
+// up front so calls and returns never reallocate, which also keeps slot
+// addresses valid for ByRef and argument views (ArgSpan) valid for builtins.
+// ============================================================================
+const size_t FRAMES_MAX = 16384;
+const size_t SLOTS_MAX  = FRAMES_MAX * 16;
+const size_t STACK_MAX  = SLOTS_MAX;
+
+struct CallFrame {
+    std::shared_ptr<ObjFunction> function;      // nullptr for the main chunk
+    ObjFunction::CodeChunk* chunk = nullptr;  // mutable: the VM quickens opcodes in place
+    int ip = 0;            // resume point while a callee is running
+    size_t slotBase = 0;   // first local slot in VM::slots
+    size_t stackBase = 0;  // value stack depth to restore on return
+};
+
 // ============================================================================  
 // Virtual Machine
 // ============================================================================
@@ -851,9 +2152,18 @@ struct VM {
     std::shared_ptr<Environment> globals;
     std::shared_ptr<Environment> environment;
     ObjFunction::CodeChunk mainChunk;
+    int mainLocalCount = 0; // hidden slots used by top-level code (For loop state)
+    std::vector<CallFrame> frames;
+    std::vector<Value> slots;
     // Module Extends - map[typeName][methodName] → BuiltinFn
     std::unordered_map<std::string,
-        std::unordered_map<std::string, Value>> extensionMethods;
+        std::unordered_map<Symbol, Value>> extensionMethods;
+
+    VM() {
+        frames.reserve(FRAMES_MAX);
+        slots.reserve(SLOTS_MAX);
+        stack.reserve(STACK_MAX);
+    }
 };
 
 // ----------------------------------------------------------------------------  
@@ -861,7 +2171,7 @@ struct VM {
 // ----------------------------------------------------------------------------
 Value pop(VM& vm) {
     if (vm.stack.empty()) {
-        debugLog("OP_POP: Attempted to pop from an empty stack.");
+        DEBUG_TRACE(TRACE_VM, "OP_POP: Attempted to pop from an empty stack.");
         runtimeError("VM: Stack underflow on POP.");
     }
     Value v = vm.stack.back();
@@ -870,8 +2180,74 @@ Value pop(VM& vm) {
 }
 
 
-Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk);
+// ----------------------------------------------------------------------------  
+// Helper: push a call frame for a scripted function. The top `argc` values of
+// the stack are moved into the new slot window (after the receiver for methods
+// and extensions) and
+// missing optional parameters get their defaults. `stackBase` is the depth the
+// stack is cut back to now and again when the callee returns.
+// ----------------------------------------------------------------------------
+void pushFrame(VM& vm, const std::shared_ptr<ObjFunction>& fn, int argc,
+               const Value& receiver, size_t stackBase) {
+    int total    = fn->params.size();
+    int required = fn->arity;
+    if (argc < required || argc > total) {
+        runtimeError("VM: Expected between " + std::to_string(required) + " and " +
+                     std::to_string(total) + " arguments for function " + fn->name);
+    }
+    size_t base = vm.slots.size();
+    size_t need = std::max<size_t>(fn->localCount, (fn->hasReceiver ? 1 : 0) + total);
+    if (vm.frames.size() >= FRAMES_MAX || base + need > SLOTS_MAX || vm.stack.size() >= STACK_MAX)
+        runtimeError("VM: Stack overflow calling " + fn->name + ".");
+    vm.slots.resize(base + need);
+
+    Value* window = vm.slots.data() + base;
+    if (fn->hasReceiver)
+        *window++ = receiver;
+    Value* args = vm.stack.data() + vm.stack.size() - argc;
+    for (int i = 0; i < argc; i++)
+        window[i] = std::move(args[i]);
+    for (int i = argc; i < total; i++)
+        window[i] = fn->params[i].defaultValue;
+    vm.stack.resize(stackBase);
+
+    CallFrame frame;
+    frame.function  = fn;
+    frame.chunk     = &fn->chunk;
+    frame.slotBase  = base;
+    frame.stackBase = stackBase;
+    vm.frames.push_back(std::move(frame));
+}
+
+Value runFrames(VM& vm);
+
+// Run top-level code (the main chunk) in its own frame.
+Value runVM(VM& vm, ObjFunction::CodeChunk& chunk) {
+    CallFrame frame;
+    frame.chunk     = &chunk;
+    frame.slotBase  = vm.slots.size();
+    vm.slots.resize(frame.slotBase + vm.mainLocalCount);
+    frame.stackBase = vm.stack.size();
+    vm.frames.push_back(std::move(frame));
+    return runFrames(vm);
+}
 
+// ----------------------------------------------------------------------------  
+// Helper: call a scripted function from host code (callbacks, extension
+// wrappers, main()) and return its result. Callers fill in optional arguments.
+// ----------------------------------------------------------------------------
+Value runFunction(VM& vm, const std::shared_ptr<ObjFunction>& fn,
+                  ArgSpan args, const Value& receiver = Value(std::monostate{})) {
+    size_t stackBase = vm.stack.size();
+    // args may be a view into vm.stack itself (a builtin passing its own
+    // arguments on), so the pushes below must not reallocate it.
+    if (stackBase + args.size() > STACK_MAX)
+        runtimeError("VM: Stack overflow calling " + fn->name + ".");
+    for (const Value& arg : args)
+        vm.stack.push_back(arg);
+    pushFrame(vm, fn, (int)args.size(), receiver, stackBase);
+    return runFrames(vm);
+}
 
 
 // ============================================================================
@@ -946,7 +2322,7 @@ static inline std::string extKeyFromValue(const Value& v)
 //     if (holds<BuiltinFn>(target)) {
 //         BuiltinFn fn = getVal<BuiltinFn>(target);
 
-//         BuiltinFn bound = [fn, receiver](const std::vector<Value>& args) -> Value {
+//         BuiltinFn bound = [fn, receiver](ArgSpan args) -> Value {
 //             std::vector<Value> full;
 //             full.reserve(args.size() + 1);
 //             full.push_back(receiver);                 // receiver becomes args[0]
@@ -960,7 +2336,7 @@ static inline std::string extKeyFromValue(const Value& v)
 //     // If you ever store raw ObjFunction for extensions, you can handle it here.
 //     if (holds<std::shared_ptr<ObjFunction>>(target)) {
 //         auto fnObj = getVal<std::shared_ptr<ObjFunction>>(target);
-//         BuiltinFn bound = [fnObj, receiver](const std::vector<Value>& args) -> Value {
+//         BuiltinFn bound = [fnObj, receiver](ArgSpan args) -> Value {
 //             if (!globalVM) runtimeError("No active VM for extension call.");
 
 //             auto previousEnv = globalVM->environment;
@@ -983,7 +2359,7 @@ static inline std::string extKeyFromValue(const Value& v)
 // }
 
 // Helper: bind extension methods for any receiver type.
-// Looks up vm.extensionMethods[bucket][methodLower] where bucket is chosen
+// Looks up vm.extensionMethods[bucket][method] where bucket is chosen
 // from runtime type name and per-type synonyms (integer, double, boolean,
 // string, array, plugin/instance, and a generic "object" bucket).
 //
@@ -992,8 +2368,11 @@ static inline std::string extKeyFromValue(const Value& v)
 //   - Value(ObjBoundMethod) : for scripted extension functions
 //   - Value(std::monostate{}): if not found
 //
-Value bindExtensionMethod(VM& vm, const Value& receiver, const std::string& methodLower)
+Value bindExtensionMethod(VM& vm, const Value& receiver, Symbol method)
 {
+    if (vm.extensionMethods.empty())
+        return Value(std::monostate{});
+
     std::vector<std::string> buckets;
 
     // Primary type name from your runtime helper (e.g. "Integer", "String", "Color")
@@ -1065,7 +2444,7 @@ Value bindExtensionMethod(VM& vm, const Value& receiver, const std::string& meth
             continue;
 
         auto& methods = bIt->second;
-        auto mIt = methods.find(methodLower);
+        auto mIt = methods.find(method);
         if (mIt == methods.end())
             continue;
 
@@ -1075,7 +2454,7 @@ Value bindExtensionMethod(VM& vm, const Value& receiver, const std::string& meth
         if (holds<BuiltinFn>(fnVal)) {
             BuiltinFn fn = getVal<BuiltinFn>(fnVal);
             // Pre-bind 'receiver' as first argument
-            BuiltinFn bound = [fn, receiver](const std::vector<Value>& args) -> Value {
+            BuiltinFn bound = [fn, receiver](ArgSpan args) -> Value {
                 std::vector<Value> full;
                 full.reserve(args.size() + 1);
                 full.push_back(receiver);          // Extends receiver
@@ -1089,7 +2468,7 @@ Value bindExtensionMethod(VM& vm, const Value& receiver, const std::string& meth
         if (holds<std::shared_ptr<ObjFunction>>(fnVal)) {
             auto bm = std::make_shared<ObjBoundMethod>();
             bm->receiver = receiver;
-            bm->name     = methodLower;
+            bm->name     = method;
             return Value(bm);
         }
 
@@ -1147,9 +2526,10 @@ std::string getTypeName(const Value& v) {
         std::string operator()(const std::shared_ptr<ObjModule>&) const { return "ObjModule"; }
         std::string operator()(const std::shared_ptr<ObjEnum>&) const { return "ObjEnum"; }
         std::string operator()(const std::shared_ptr<ObjRef>&) const { return "ObjRef"; }
+        std::string operator()(const std::shared_ptr<ObjDictionary>&) const { return "ObjDictionary"; }
         std::string operator()(void* ptr) const { return "pointer"; }
     } visitor;
-    return std::visit(visitor, v);
+    return visitValue(visitor, v);
 }
 
 
@@ -1190,8 +2570,7 @@ static Value wrapHandleIfPluginClass(const std::string &raw,
     auto inst = std::make_shared<ObjInstance>();
     inst->klass = cls;
     inst->pluginInstance = reinterpret_cast<void *>((intptr_t)std::stol(raw));
-    for (auto &p : cls->properties)
-        inst->fields[p.first] = p.second;
+    inst->initFields();
     return Value(inst);
 }
 
@@ -1318,30 +2697,33 @@ void invokeScriptCallback(const Value& funcVal, const char* param)
 
     // 3) Log entry
     std::string p = param ? param : "";
-    debugLog("invokeScriptCallback: Called with param: " + (p.empty() ? "null" : p));
+    DEBUG_TRACE(TRACE_PLUGIN, "invokeScriptCallback: Called with param: " + (p.empty() ? "null" : p));
 
     // 4) Dispatch either a host function or a script function
     if (holds<BuiltinFn>(funcVal)) {
-        debugLog("invokeScriptCallback: Detected BuiltinFn.");
+        DEBUG_TRACE(TRACE_PLUGIN, "invokeScriptCallback: Detected BuiltinFn.");
         BuiltinFn hostFn = getVal<BuiltinFn>(funcVal);
 
         // Preserve legacy behavior for BuiltinFn callbacks: a single string param.
-        hostFn({ Value(p) });
-        debugLog("invokeScriptCallback: BuiltinFn executed.");
+        Value callArgs[] = { Value(p) };
+        hostFn(ArgSpan(callArgs, 1));
+        DEBUG_TRACE(TRACE_PLUGIN, "invokeScriptCallback: BuiltinFn executed.");
     }
     else if (holds<std::shared_ptr<ObjFunction>>(funcVal)) {
-        debugLog("invokeScriptCallback: Detected ObjFunction.");
+        DEBUG_TRACE(TRACE_PLUGIN, "invokeScriptCallback: Detected ObjFunction.");
         auto fnObj = getVal<std::shared_ptr<ObjFunction>>(funcVal);
 
-        // 5) Swap in a fresh environment (child of globals)
+        // 5) Run name lookups against globals, wherever the callback fired from
         auto previousEnv = globalVM->environment;
-        globalVM->environment = std::make_shared<Environment>(globalVM->globals);
+        globalVM->environment = globalVM->globals;
 
         // 6) If the handler expects multiple args, split "x,y" into tokens.
         //    If it expects one arg, pass the raw string through unmodified.
         std::vector<std::string> rawArgs = _cbSplitArgs(p, fnObj->params.size());
 
-        // 7) Define parameters (or default values)
+        // 7) Bind parameters (or default values) to their local slots
+        std::vector<Value> args;
+        args.reserve(fnObj->params.size());
         for (size_t i = 0; i < fnObj->params.size(); ++i) {
             const auto& pd = fnObj->params[i];
 
@@ -1353,12 +2735,12 @@ void invokeScriptCallback(const Value& funcVal, const char* param)
                 actual = pd.defaultValue;
             }
 
-            globalVM->environment->define(pd.name, actual);
+            args.push_back(actual);
         }
 
         // 8) Execute the function body
-        Value result = runVM(*globalVM, fnObj->chunk);
-        debugLog("invokeScriptCallback: Function executed with result: " + valueToString(result));
+        Value result = runFunction(*globalVM, fnObj, args);
+        DEBUG_TRACE(TRACE_PLUGIN, "invokeScriptCallback: Function executed with result: " + valueToString(result));
 
         // 9) Restore the old environment
         globalVM->environment = previousEnv;
@@ -1377,45 +2759,45 @@ void invokeScriptCallback(const Value& funcVal, const char* param)
 // // This function is called by the ffi closure.
 void scriptCallbackTrampoline(ffi_cif* cif, void* ret, void** args, void* user_data) {
     // Log entry and key pointer values.
-    debugLog("scriptCallbackTrampoline: Entered.");
-    debugLog("  cif pointer: " + std::to_string(reinterpret_cast<uintptr_t>(cif)));
-    debugLog("  ret pointer: " + std::to_string(reinterpret_cast<uintptr_t>(ret)));
-    debugLog("  user_data pointer: " + std::to_string(reinterpret_cast<uintptr_t>(user_data)));
+    DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: Entered.");
+    DEBUG_TRACE(TRACE_PLUGIN, "  cif pointer: " + std::to_string(reinterpret_cast<uintptr_t>(cif)));
+    DEBUG_TRACE(TRACE_PLUGIN, "  ret pointer: " + std::to_string(reinterpret_cast<uintptr_t>(ret)));
+    DEBUG_TRACE(TRACE_PLUGIN, "  user_data pointer: " + std::to_string(reinterpret_cast<uintptr_t>(user_data)));
     
     // If available, log the number of arguments from the CIF.
     int nargs = 1;
     #ifdef FFI_CIF_NARGS
       nargs = cif->nargs;
     #endif
-    debugLog("  Number of arguments (nargs): " + std::to_string(nargs));
+    DEBUG_TRACE(TRACE_PLUGIN, "  Number of arguments (nargs): " + std::to_string(nargs));
 
     if (args == nullptr) {
-         debugLog("scriptCallbackTrampoline: args is null!");
+         DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: args is null!");
          return;
     }
-    debugLog("  args pointer: " + std::to_string(reinterpret_cast<uintptr_t>(args)));
+    DEBUG_TRACE(TRACE_PLUGIN, "  args pointer: " + std::to_string(reinterpret_cast<uintptr_t>(args)));
     
     // Log each argument's pointer value.
     for (int i = 0; i < nargs; i++) {
-         debugLog("  args[" + std::to_string(i) + "] pointer: " + std::to_string(reinterpret_cast<uintptr_t>(args[i])));
+         DEBUG_TRACE(TRACE_PLUGIN, "  args[" + std::to_string(i) + "] pointer: " + std::to_string(reinterpret_cast<uintptr_t>(args[i])));
     }
     
     // Since we now expect one parameter (a const char*), try to extract it.
     const char* param = *(const char**)args[0];
-    debugLog("scriptCallbackTrampoline: Parameter: " + std::string(param ? param : "null"));
+    DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: Parameter: " + std::string(param ? param : "null"));
     
     Value* funcVal = (Value*)user_data;
-    debugLog("scriptCallbackTrampoline: user_data as funcVal pointer: " +
+    DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: user_data as funcVal pointer: " +
              std::to_string(reinterpret_cast<uintptr_t>(funcVal)));
     
     // Now, if on the main thread, invoke directly; else, queue the callback.
     // Queued callbacks immediately handled with processpendingCallbacks() for proper concurrent threading and access.
     if (std::this_thread::get_id() == mainThreadId) {
-         debugLog("scriptCallbackTrampoline: On main thread, invoking callback directly.");
+         DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: On main thread, invoking callback directly.");
          invokeScriptCallback(*funcVal, param);
     } else {
-         debugLog("scriptCallbackTrampoline: Not on main thread, queueing callback.");
-         std::lock_guard<std::mutex> lock(callbackQueueMutex);
+         DEBUG_TRACE(TRACE_PLUGIN, "scriptCallbackTrampoline: Not on main thread, queueing callback.");
+         pendingCallbacks.fetch_add(1, std::memory_order_relaxed);
          callbackQueue.push(CallbackRequest{ *funcVal, param ? std::string(param) : std::string("") });
     }
 }
@@ -1425,9 +2807,9 @@ void scriptCallbackTrampoline(ffi_cif* cif, void* ret, void** args, void* user_d
 // ------------------------------------------------------------------------------------
 static std::unordered_set<ffi_closure*> liveClosures;   // <‑‑ keeps them alive
 
-BuiltinFn addressOfBuiltin = [](const std::vector<Value>& args) -> Value
+BuiltinFn addressOfBuiltin = [](ArgSpan args) -> Value
 {
-    debugLog("AddressOf: received " + std::to_string(args.size()) + " arg(s)");
+    DEBUG_TRACE(TRACE_PLUGIN, "AddressOf: received " + std::to_string(args.size()) + " arg(s)");
     if (args.size() != 1)
         runtimeError("AddressOf expects exactly one argument");
 
@@ -1469,7 +2851,7 @@ BuiltinFn addressOfBuiltin = [](const std::vector<Value>& args) -> Value
     // Keep the closure alive until its Deref'd or closed.
     liveClosures.insert(closure);
 
-    debugLog("AddressOf: returning callback pointer " +
+    DEBUG_TRACE(TRACE_PLUGIN, "AddressOf: returning callback pointer " +
              std::to_string(reinterpret_cast<uintptr_t>(entryPoint)));
     return Value(entryPoint);   // expose the raw code pointer to the script
 };
@@ -1479,9 +2861,9 @@ BuiltinFn addressOfBuiltin = [](const std::vector<Value>& args) -> Value
 // -----------------------------------------------------------------------------
 //  AddHandlerBuiltin   – (instance, eventKey, callbackPtr)  → Boolean
 // -----------------------------------------------------------------------------
-BuiltinFn addHandlerBuiltin = [](const std::vector<Value>& args) -> Value
+BuiltinFn addHandlerBuiltin = [](ArgSpan args) -> Value
 {
-    debugLog("AddHandler: received " + std::to_string(args.size()) + " arg(s)");
+    DEBUG_TRACE(TRACE_PLUGIN, "AddHandler: received " + std::to_string(args.size()) + " arg(s)");
     if (args.size() != 2)
         runtimeError("AddHandler expects exactly two arguments");
 
@@ -1492,7 +2874,7 @@ BuiltinFn addHandlerBuiltin = [](const std::vector<Value>& args) -> Value
         runtimeError("AddHandler: first argument must be the event identifier string");
 
     const std::string target = getVal<std::string>(args[0]);
-    debugLog("AddHandler: target = " + target);
+    DEBUG_TRACE(TRACE_PLUGIN, "AddHandler: target = " + target);
 
     const size_t p1 = target.find(':');
     const size_t p2 = target.find(':', p1 + 1);
@@ -1510,7 +2892,7 @@ BuiltinFn addHandlerBuiltin = [](const std::vector<Value>& args) -> Value
         runtimeError("AddHandler: second argument must be a pointer returned by AddressOf");
     void* callbackPtr = getVal<void*>(args[1]);
 
-    debugLog("AddHandler: plugin=" + pluginName +
+    DEBUG_TRACE(TRACE_PLUGIN, "AddHandler: plugin=" + pluginName +
              "  handle=" + std::to_string(handle) +
              "  event="  + eventName +
              "  cbPtr="  + std::to_string(reinterpret_cast<uintptr_t>(callbackPtr)));
@@ -1528,11 +2910,12 @@ BuiltinFn addHandlerBuiltin = [](const std::vector<Value>& args) -> Value
     BuiltinFn setEventCallback = getVal<BuiltinFn>(setterVal);
 
     // Call into the plugin:  Boolean SetEventCallback(Integer handle, String  eventName, Ptr callback)
-    Value ok = setEventCallback({ Value(handle),
-                                  Value(eventName),
-                                  Value(callbackPtr) });
+    Value callArgs[] = { Value(handle),
+                         Value(eventName),
+                         Value(callbackPtr) };
+    Value ok = setEventCallback(ArgSpan(callArgs, 3));
 
-    debugLog("AddHandler: plugin returned " + valueToString(ok));
+    DEBUG_TRACE(TRACE_PLUGIN, "AddHandler: plugin returned " + valueToString(ok));
     return ok;
 };
 
@@ -1590,8 +2973,9 @@ struct CallExpr : Expr {
 
 struct ArrayLiteralExpr : Expr {
     std::vector<std::shared_ptr<Expr>> elements;
-    ArrayLiteralExpr(const std::vector<std::shared_ptr<Expr>>& elements)
-        : elements(elements) { }
+    std::string elementType;   // from `Dim a() As <type>`; picks the array's storage
+    ArrayLiteralExpr(const std::vector<std::shared_ptr<Expr>>& elements, const std::string& elementType = "")
+        : elements(elements), elementType(elementType) { }
 };
 
 struct GetPropExpr : Expr {
@@ -1700,6 +3084,27 @@ struct IfStmt : Stmt {
         : condition(condition), thenBranch(thenBranch), elseBranch(elseBranch) { }
 };
 
+// Select Case: the selector is evaluated once, then the clauses are tried in
+// order. A clause matches if any of its comma-separated tests does.
+struct SelectStmt : Stmt {
+    struct CaseTest {
+        enum Kind { VALUE, RANGE, IS } kind = VALUE;
+        std::shared_ptr<Expr> value; // VALUE; RANGE's lower bound; IS's operand
+        std::shared_ptr<Expr> upper; // RANGE (value To upper)
+        BinaryOp op = BinaryOp::EQ;  // IS (Is <op> value)
+    };
+    struct Clause {
+        std::vector<CaseTest> tests;
+        std::vector<std::shared_ptr<Stmt>> body;
+    };
+    std::shared_ptr<Expr> selector;
+    std::vector<Clause> clauses;
+    std::vector<std::shared_ptr<Stmt>> elseBranch;
+    SelectStmt(std::shared_ptr<Expr> selector, const std::vector<Clause>& clauses,
+        const std::vector<std::shared_ptr<Stmt>>& elseBranch)
+        : selector(selector), clauses(clauses), elseBranch(elseBranch) { }
+};
+
 struct WhileStmt : Stmt {
     std::shared_ptr<Expr> condition;
     std::vector<std::shared_ptr<Stmt>> body;
@@ -1726,12 +3131,14 @@ struct ForStmt : Stmt {
     std::shared_ptr<Expr> end;
     std::shared_ptr<Expr> step;
     std::vector<std::shared_ptr<Stmt>> body;
+    bool isDown; // DownTo: the counter always moves down by |step|
     ForStmt(const std::string& varName,
         std::shared_ptr<Expr> start,
         std::shared_ptr<Expr> end,
         std::shared_ptr<Expr> step,
-        const std::vector<std::shared_ptr<Stmt>>& body)
-        : varName(varName), start(start), end(end), step(step), body(body) { }
+        const std::vector<std::shared_ptr<Stmt>>& body,
+        bool isDown = false)
+        : varName(varName), start(start), end(end), step(step), body(body), isDown(isDown) { }
 };
 
 // Module AST node
@@ -1789,12 +3196,12 @@ class Parser {
 public:
     Parser(const std::vector<Token>& tokens) : tokens(tokens), inModule(false) {}
     std::vector<std::shared_ptr<Stmt>> parse() {
-       debugLog("Parser: Starting parse. Total tokens: " + std::to_string(tokens.size()));
+       DEBUG_TRACE(TRACE_GENERAL, "Parser: Starting parse. Total tokens: " + std::to_string(tokens.size()));
         std::vector<std::shared_ptr<Stmt>> statements;
         while (!isAtEnd()) {
             statements.push_back(declaration());
         }
-        debugLog("Parser: Finished parse.");
+        DEBUG_TRACE(TRACE_GENERAL, "Parser: Finished parse.");
         return statements;
     }
     
@@ -2258,7 +3665,7 @@ private:
         if (!initializer && match({ XTokenType::EQUAL }))
             initializer = expression();
         else if (isArray)
-            initializer = std::make_shared<ArrayLiteralExpr>(std::vector<std::shared_ptr<Expr>>{});
+            initializer = std::make_shared<ArrayLiteralExpr>(std::vector<std::shared_ptr<Expr>>{}, typeStr);
         else if (typeStr == "pointer" || typeStr == "ptr")
             initializer = std::make_shared<LiteralExpr>(static_cast<void*>(nullptr)); // Initialize pointer to nullptr
         return std::make_shared<VarStmt>(name.lexeme, initializer, typeStr, isConstant, access);
@@ -2332,27 +3739,7 @@ private:
         consume(XTokenType::NEXT, "Expect 'Next' after For loop body.");
         if (check(XTokenType::IDENTIFIER)) advance();
     
-        // Create the initializer for the loop variable
-        std::shared_ptr<Stmt> initializer = std::make_shared<VarStmt>(varName.lexeme, startExpr);
-        std::shared_ptr<Expr> loopVar = std::make_shared<VariableExpr>(varName.lexeme);
-    
-        // Set loop condition: <= for upward, >= for downward
-        std::shared_ptr<Expr> condition;
-        if (isDown) {
-            condition = std::make_shared<BinaryExpr>(loopVar, BinaryOp::GE, endExpr);
-        } else {
-            condition = std::make_shared<BinaryExpr>(loopVar, BinaryOp::LE, endExpr);
-        }
-    
-        // Update the loop variable: always using addition (the step will be negative if downward)
-        std::shared_ptr<Expr> increment = std::make_shared<AssignmentExpr>(
-            varName.lexeme,
-            std::make_shared<BinaryExpr>(loopVar, BinaryOp::ADD, stepExpr)
-        );
-        body.push_back(std::make_shared<ExpressionStmt>(increment));
-    
-        std::vector<std::shared_ptr<Stmt>> forBlock = { initializer, std::make_shared<WhileStmt>(condition, body) };
-        return std::make_shared<BlockStmt>(forBlock);
+        return std::make_shared<ForStmt>(varName.lexeme, startExpr, endExpr, stepExpr, body, isDown);
     }
     
     std::shared_ptr<Stmt> whileStatement() {
@@ -2653,94 +4040,112 @@ private:
     }
 
     // ***** selectCaseStatement() to support "Select Case" constructs *****
+    // Each Case takes a comma-separated list of tests: a value, a range
+    // (low To high) or a comparison against the selector (Is >= value).
     std::shared_ptr<Stmt> selectCaseStatement() {
         consume(XTokenType::CASE, "Expect 'Case' after 'Select' in Select Case statement.");
         std::shared_ptr<Expr> switchExpr = expression();
-        struct CaseClause {
-            bool isDefault = false;
-            std::shared_ptr<Expr> expr;
-            std::vector<std::shared_ptr<Stmt>> statements;
-        };
-        std::vector<CaseClause> clauses;
+        std::vector<SelectStmt::Clause> clauses;
+        std::vector<std::shared_ptr<Stmt>> elseBranch;
         while (!check(XTokenType::END)) {
             consume(XTokenType::CASE, "Expect 'Case' at start of case clause.");
-            CaseClause clause;
             if (match({ XTokenType::ELSE })) {
-                clause.isDefault = true;
-            }
-            else {
-                clause.isDefault = false;
-                clause.expr = expression();
+                elseBranch = block({ XTokenType::CASE, XTokenType::END });
+                continue;
             }
-            clause.statements = block({ XTokenType::CASE, XTokenType::END });
+            SelectStmt::Clause clause;
+            do {
+                clause.tests.push_back(caseTest());
+            } while (match({ XTokenType::COMMA }));
+            clause.body = block({ XTokenType::CASE, XTokenType::END });
             clauses.push_back(clause);
         }
         consume(XTokenType::END, "Expect 'End' after Select Case statement.");
         consume(XTokenType::SELECT, "Expect 'Select' after 'End' in Select Case statement.");
-        std::vector<std::shared_ptr<Stmt>> currentElse;
-        for (int i = clauses.size() - 1; i >= 0; i--) {
-            if (clauses[i].isDefault) {
-                currentElse = clauses[i].statements;
-            }
-            else {
-                auto condition = std::make_shared<BinaryExpr>(switchExpr, BinaryOp::EQ, clauses[i].expr);
-                auto ifStmt = std::make_shared<IfStmt>(condition, clauses[i].statements, currentElse);
-                currentElse.clear();
-                currentElse.push_back(ifStmt);
-            }
-        }
-        if (currentElse.empty()) {
-            return std::make_shared<BlockStmt>(std::vector<std::shared_ptr<Stmt>>{});
+        return std::make_shared<SelectStmt>(switchExpr, clauses, elseBranch);
+    }
+
+    SelectStmt::CaseTest caseTest() {
+        SelectStmt::CaseTest test;
+        // "Is" is only a keyword here, directly followed by a comparison.
+        if (check(XTokenType::IDENTIFIER) && toLower(peek().lexeme) == "is" &&
+            current + 1 < (int)tokens.size()) {
+            BinaryOp op;
+            bool isComparison = true;
+            switch (tokens[current + 1].type) {
+            case XTokenType::EQUAL:         op = BinaryOp::EQ; break;
+            case XTokenType::NOT_EQUAL:     op = BinaryOp::NE; break;
+            case XTokenType::LESS:          op = BinaryOp::LT; break;
+            case XTokenType::LESS_EQUAL:    op = BinaryOp::LE; break;
+            case XTokenType::GREATER:       op = BinaryOp::GT; break;
+            case XTokenType::GREATER_EQUAL: op = BinaryOp::GE; break;
+            default: isComparison = false; break;
+            }
+            if (isComparison) {
+                advance(); // Is
+                advance(); // the comparison
+                test.kind = SelectStmt::CaseTest::IS;
+                test.op = op;
+                test.value = expression();
+                return test;
+            }
+        }
+        test.value = expression();
+        if (match({ XTokenType::TO })) {
+            test.kind = SelectStmt::CaseTest::RANGE;
+            test.upper = expression();
         }
-        return currentElse[0];
+        return test;
     }
     // ***** End of Select Case support *****
 };
 
 // ============================================================================  
 // Helpers for constant pool management
+// Scalar and string constants are hash-consed: a chunk gets one slot per
+// distinct value, and all chunks compiled together share a single copy of
+// each one through the Compiler's pool (strings are refcounted boxes, so a
+// pool entry is only a reference). Functions, classes and other objects
+// always get a new slot.
 // ============================================================================
-int addConstant(ObjFunction::CodeChunk& chunk, const Value& v) {
-    chunk.constants.push_back(v);
-    return chunk.constants.size() - 1;
-}
 
-int addConstantString(ObjFunction::CodeChunk& chunk, const std::string& s) {
-    for (int i = 0; i < chunk.constants.size(); i++) {
-        if (holds<std::string>(chunk.constants[i])) {
-            if (getVal<std::string>(chunk.constants[i]) == s)
-                return i;
-        }
+// Builds the pooling key (type tag + payload) for v; false if v isn't pooled.
+static bool constantKey(const Value& v, std::string& key) {
+    key.assign(1, static_cast<char>(v.index()));
+    auto appendBytes = [&key](const auto& x) {
+        key.append(reinterpret_cast<const char*>(&x), sizeof x);
+    };
+    switch (v.index()) {
+    case Value::tagOf<std::monostate>: return true;
+    case Value::tagOf<int>:            appendBytes(v.ref<int>()); return true;
+    case Value::tagOf<double>:         appendBytes(v.ref<double>()); return true;
+    case Value::tagOf<bool>:           key += v.ref<bool>() ? '1' : '0'; return true;
+    case Value::tagOf<Color>:          appendBytes(v.ref<Color>().value); return true;
+    case Value::tagOf<std::string>:    key += v.ref<std::string>(); return true;
+    default:                           return false;
     }
-    chunk.constants.push_back(s);
-    return chunk.constants.size() - 1;
 }
 
 // ============================================================================  
 // Built-in Array Methods
 // ============================================================================
-Value callArrayMethod(std::shared_ptr<ObjArray> array, const std::string& method, const std::vector<Value>& args) {
-    std::string m = toLower(method);
-    if (m == "add") {
+Value callArrayMethod(std::shared_ptr<ObjArray> array, Symbol method, ArgSpan args) {
+    if (method == SYM_ADD) {
         if (args.size() != 1) runtimeError("Array.add expects 1 argument.");
-        array->elements.push_back(args[0]);
+        array->append(args[0]);
         return Value(std::monostate{});
     }
-    else if (m == "indexof") {
+    else if (method == SYM_INDEXOF) {
         if (args.size() != 1) runtimeError("Array.indexof expects 1 argument.");
-        for (size_t i = 0; i < array->elements.size(); i++) {
-            if (valueToString(array->elements[i]) == valueToString(args[0]))
-                return (int)i;
-        }
-        return -1;
+        return array->indexOf(args[0]);
     }
-    else if (m == "lastindex") {
-        return array->elements.empty() ? -1 : (int)(array->elements.size() - 1);
+    else if (method == SYM_LASTINDEX) {
+        return array->empty() ? -1 : (int)(array->size() - 1);
     }
-    else if (m == "count") {
-        return (int)array->elements.size();
+    else if (method == SYM_COUNT) {
+        return (int)array->size();
     }
-    else if (m == "join") {
+    else if (method == SYM_JOIN) {
     // Array.join(separator As String) As String
     if (args.size() != 1) 
         runtimeError("Array.join expects exactly one argument: the separator string.");
@@ -2749,44 +4154,107 @@ Value callArrayMethod(std::shared_ptr<ObjArray> array, const std::string& method
 
     const std::string sep = getVal<std::string>(args[0]);
     std::string result;
-    for (size_t i = 0; i < array->elements.size(); ++i) {
+    for (size_t i = 0; i < array->size(); ++i) {
         // ensure each element is a string
-        if (!holds<std::string>(array->elements[i]))
+        if (array->storage != ObjArray::Storage::VALUES || !holds<std::string>(array->elements[i]))
             runtimeError("Array.join: all elements must be strings.");
         result += getVal<std::string>(array->elements[i]);
-        if (i + 1 < array->elements.size())
+        if (i + 1 < array->size())
             result += sep;
     }
     return Value(result);
     }
 
-    else if (m == "pop") {
-        if (array->elements.empty()) runtimeError("Array.pop called on empty array.");
-        Value last = array->elements.back();
-        array->elements.pop_back();
-        return last;
+    else if (method == SYM_POP) {
+        if (array->empty()) runtimeError("Array.pop called on empty array.");
+        return array->removeLast();
     }
-    else if (m == "removeat") {
+    else if (method == SYM_REMOVEAT) {
         if (args.size() != 1) runtimeError("Array.removeat expects 1 argument.");
         int index = 0;
         if (holds<int>(args[0]))
             index = getVal<int>(args[0]);
         else runtimeError("Array.removeat expects an integer index.");
-        if (index < 0 || index >= (int)array->elements.size())
+        if (index < 0 || index >= (int)array->size())
             runtimeError("Array.removeat index out of bounds.");
-        array->elements.erase(array->elements.begin() + index);
+        array->removeAt(index);
         return Value(std::monostate{});
     }
-    else if (m == "removeall") {
-        array->elements.clear();
+    else if (method == SYM_REMOVEALL) {
+        array->clear();
         return Value(std::monostate{});
     }
     else {
-        runtimeError("Unknown array method: " + method);
+        runtimeError("Unknown array method: " + symbolName(method));
     }
     return Value(std::monostate{});
 }
 
+// ============================================================================  
+// Built-in Dictionary Methods
+// ============================================================================
+Value callDictionaryMethod(std::shared_ptr<ObjDictionary> dict, Symbol method, ArgSpan args) {
+    if (method == SYM_VALUE) {
+        // d.Value(key) reads; d.Value(key) = v arrives as d.Value(key, v).
+        if (args.size() == 2) {
+            dict->set(args[0], args[1]);
+            return args[1];
+        }
+        if (args.size() != 1) runtimeError("Dictionary.value expects 1 argument.");
+        if (Value* v = dict->lookup(args[0]))
+            return *v;
+        runtimeError("Dictionary.value: key not found: " + valueToString(args[0]));
+    }
+    else if (method == SYM_LOOKUP) {
+        if (args.size() != 2) runtimeError("Dictionary.lookup expects 2 arguments.");
+        Value* v = dict->lookup(args[0]);
+        return v ? *v : args[1];
+    }
+    else if (method == SYM_HASKEY) {
+        if (args.size() != 1) runtimeError("Dictionary.haskey expects 1 argument.");
+        return dict->find(args[0]) >= 0;
+    }
+    else if (method == SYM_REMOVE) {
+        if (args.size() != 1) runtimeError("Dictionary.remove expects 1 argument.");
+        if (!dict->remove(args[0]))
+            runtimeError("Dictionary.remove: key not found: " + valueToString(args[0]));
+        return Value(std::monostate{});
+    }
+    else if (method == SYM_REMOVEALL || method == SYM_CLEAR) {
+        dict->clear();
+        return Value(std::monostate{});
+    }
+    else if (method == SYM_COUNT || method == SYM_KEYCOUNT) {
+        return (int)dict->count();
+    }
+    else if (method == SYM_KEYS || method == SYM_VALUES) {
+        bool keys = (method == SYM_KEYS);
+        auto arr = std::make_shared<ObjArray>();
+        for (auto& e : dict->entries)
+            if (e.live)
+                arr->append(keys ? e.key : e.value);
+        return Value(arr);
+    }
+    else if (method == SYM_KEY) {
+        if (args.size() != 1 || !holds<int>(args[0]))
+            runtimeError("Dictionary.key expects an integer index.");
+        int index = getVal<int>(args[0]);
+        if (index < 0 || index >= (int)dict->count())
+            runtimeError("Dictionary.key index out of bounds.");
+        return dict->entryAt(index).key;
+    }
+    else if (method == SYM_RESERVE) {
+        if (args.size() != 1 || !holds<int>(args[0]))
+            runtimeError("Dictionary.reserve expects an integer capacity.");
+        dict->reserve((size_t)std::max(0, getVal<int>(args[0])));
+        return Value(std::monostate{});
+    }
+    else if (method == SYM_TOSTRING) {
+        return valueToString(Value(dict));
+    }
+    runtimeError("Unknown dictionary method: " + symbolName(method));
+}
+
 // ============================================================================  
 // Plugin Loader and libffi wrappers
 // ============================================================================
@@ -2864,7 +4332,7 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
                              const char **paramTypes,
                              const char *returnTypeStr)
 {
-    debugLog("wrapPluginFunction: building wrapper  funcPtr=" + std::to_string((uintptr_t)funcPtr) + "  arity=" + std::to_string(arity));
+    DEBUG_TRACE(TRACE_PLUGIN, "wrapPluginFunction: building wrapper  funcPtr=" + std::to_string((uintptr_t)funcPtr) + "  arity=" + std::to_string(arity));
 
     // ----------------------------------------------------------------------
     // 1)  Create and prepare the libffi call interface (CIF)
@@ -2878,7 +4346,7 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
         std::string pType = toLower(pRaw);
         argTypes[i] = mapType(pType);
 
-        debugLog("  param[" + std::to_string(i) + "] = '" + pRaw + "' -> " + (argTypes[i] ? "OK" : "UNKNOWN"));
+        DEBUG_TRACE(TRACE_PLUGIN, "  param[" + std::to_string(i) + "] = '" + pRaw + "' -> " + (argTypes[i] ? "OK" : "UNKNOWN"));
 
         if (!argTypes[i])
             runtimeError("Unknown plugin parameter type: " + pType);
@@ -2887,7 +4355,7 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
     std::string retTypeString = toLower(returnTypeStr ? returnTypeStr : "variant");
     ffi_type *retType = mapType(retTypeString);
 
-    debugLog("  return type = '" + std::string(returnTypeStr ? returnTypeStr : "") + "'  -> " + (retType ? "built-in" : "custom/plugin"));
+    DEBUG_TRACE(TRACE_PLUGIN, "  return type = '" + std::string(returnTypeStr ? returnTypeStr : "") + "'  -> " + (retType ? "built-in" : "custom/plugin"));
 
     if (!retType)
         retType = &ffi_type_sint; // treat unknown returns as int
@@ -2909,19 +4377,20 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
         "string", "double", "number", "integer", "int", "boolean", "bool",
         "color", "variant", "pointer", "ptr", "array", "void"};
     bool isCustomClass = (builtinTypes.find(retTypeString) == builtinTypes.end());
-    debugLog("  isCustomClass = " + std::string(isCustomClass ? "true" : "false"));
+    DEBUG_TRACE(TRACE_PLUGIN, "  isCustomClass = " + std::string(isCustomClass ? "true" : "false"));
 
     // ----------------------------------------------------------------------
     // 4)  Return the VM-visible lambda wrapper
     // ----------------------------------------------------------------------
-    return [=](const std::vector<Value> &args) -> Value
+    return [=](ArgSpan args) -> Value
     {
-        debugLog("PluginFunction: invoked with " + std::to_string(args.size()) + " args");
+        DEBUG_TRACE(TRACE_PLUGIN, "PluginFunction: invoked with " + std::to_string(args.size()) + " args");
 
         // --------------------------------------------------------------
         // 4-a)  Argument marshalling
         // --------------------------------------------------------------
         std::vector<void*> heapAlloc;             // ➊ keep track of temp buffers
+        std::vector<std::shared_ptr<ObjArray>> sharedArrays; // Double() arrays passed in place
         
         if ((int)args.size() != arity)
             runtimeError("Plugin function expects " + std::to_string(arity) +
@@ -2951,10 +4420,20 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
                 if (holds<std::shared_ptr<ObjArray>>(args[i])) {
                     auto src = getVal<std::shared_ptr<ObjArray>>(args[i]);
 
-                    size_t n = src->elements.size();
+                    // A Double() array already is a double[]: pass its buffer.
+                    // The plugin sees the script's array itself, so anything it
+                    // writes there stays (other arrays get a throwaway copy).
+                    if (src->storage == ObjArray::Storage::DOUBLES) {
+                        ptrStorage[i] = src->doubles.empty() ? nullptr : src->doubles.data();
+                        argValues[i] = &ptrStorage[i];
+                        sharedArrays.push_back(src);
+                        continue;
+                    }
+
+                    size_t n = src->size();
                     double *buf = (n > 0) ? new double[n] : nullptr;
                     for (size_t k = 0; k < n; ++k) {
-                        const Value &v = src->elements[k];
+                        const Value v = src->get(k);
                         buf[k] =  holds<double>(v) ? getVal<double>(v)
                                 : holds<int>(v)    ? (double)getVal<int>(v)
                                 : /* otherwise */    0.0;
@@ -3043,7 +4522,7 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
                 argValues[i] = &intStorage[i];
             }
 
-            debugLog("  marshalled arg[" + std::to_string(i) + "] type=" + pType);
+            DEBUG_TRACE(TRACE_PLUGIN, "  marshalled arg[" + std::to_string(i) + "] type=" + pType);
         }
 
         // --------------------------------------------------------------
@@ -3061,13 +4540,16 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
         } result{};
 
         ffi_call(cif, FFI_FN(funcPtr), &result, argValues);
-        debugLog("  ffi_call complete");
+        DEBUG_TRACE(TRACE_PLUGIN, "  ffi_call complete");
 
         /* -----------------------------------------
         free any buffers we created for arrays
         ----------------------------------------- */
         for (void* p : heapAlloc)
             delete[] static_cast<double*>(p);   // every entry is a double[]
+        // The plugin may have written into these; drop their IndexOf tables.
+        for (auto& arr : sharedArrays)
+            arr->invalidate();
 
         // --------------------------------------------------------------
         // 4-c)  Clean up temporaries
@@ -3087,10 +4569,10 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
         // --------------------------------------------------------------
         if (isCustomClass)
         {
-            debugLog("  converting return-value as plugin class '" + retTypeString + "'");
+            DEBUG_TRACE(TRACE_PLUGIN, "  converting return-value as plugin class '" + retTypeString + "'");
             int handle = result.i;
 
-            Value clsVal = globalVM->environment->get(toLower(retTypeString));
+            Value clsVal = globalVM->environment->get(intern(retTypeString));
             if (!holds<std::shared_ptr<ObjClass>>(clsVal))
                 runtimeError("Plugin class '" + retTypeString + "' not found");
 
@@ -3099,10 +4581,9 @@ BuiltinFn wrapPluginFunction(void *funcPtr,
             inst->klass = cls;
             inst->pluginInstance = reinterpret_cast<void *>((intptr_t)handle);
 
-            for (auto &p : cls->properties)
-                inst->fields[p.first] = p.second;
+            inst->initFields();
 
-            debugLog("  returning new instance handle=" + std::to_string(handle));
+            DEBUG_TRACE(TRACE_PLUGIN, "  returning new instance handle=" + std::to_string(handle));
             return Value(inst);
         }
 
@@ -3152,7 +4633,7 @@ BuiltinFn wrapPluginFunctionForDeclare(const std::vector<Param>& params, const s
 #ifdef _WIN32
     libHandle = LoadLibraryA(libName.c_str());
     if (!libHandle) {
-        debugLog("Error loading library: " + libName);
+        DEBUG_TRACE(TRACE_PLUGIN, "Error loading library: " + libName);
         exit(1);
     }
     void* funcPtr = reinterpret_cast<void*>(GetProcAddress((HMODULE)libHandle, apiName.c_str()));
@@ -3246,7 +4727,7 @@ std::string getExecutableDir() {
 void processPluginLibrary(const std::string& libPath, VM& vm) {
     LIB_HANDLE libHandle = LOAD_LIBRARY(libPath);
     if (!libHandle) {
-        debugLog("Failed to load library: " + libPath);
+        DEBUG_TRACE(TRACE_PLUGIN, "Failed to load library: " + libPath);
         return;
     }
 
@@ -3260,7 +4741,7 @@ void processPluginLibrary(const std::string& libPath, VM& vm) {
             BuiltinFn fn = wrapPluginFunction(entry.funcPtr, entry.arity, entry.paramTypes, entry.returnType);
             std::string funcName = toLower(entry.name);
             vm.environment->define(funcName, fn);
-            debugLog("Loaded plugin function: " + std::string(entry.name) +
+            DEBUG_TRACE(TRACE_PLUGIN, "Loaded plugin function: " + std::string(entry.name) +
                      " with arity " + std::to_string(entry.arity) + " from " + libPath);
         }
     } else {
@@ -3280,15 +4761,14 @@ void processPluginLibrary(const std::string& libPath, VM& vm) {
                 BuiltinFn getterFn = wrapPluginFunction(prop.getter, 1, getterParams, prop.type);
                 const char* setterParams[2] = { "int", prop.type }; // Setter parameters
                 BuiltinFn setterFn = wrapPluginFunction(prop.setter, 2, setterParams, "void");
-                pluginClass->pluginProperties[toLower(prop.name)] = std::make_pair(getterFn, setterFn);
+                pluginClass->pluginProperties[intern(prop.name)] = std::make_pair(getterFn, setterFn);
             }
 
             // Load class methods.
             for (size_t i = 0; i < classDef->methodsCount; i++) {
                 ClassEntry& entry = classDef->methods[i];
                 BuiltinFn methodFn = wrapPluginFunction(entry.funcPtr, entry.arity, entry.paramTypes, entry.retType);
-                std::string methodName = toLower(entry.name);
-                pluginClass->methods[methodName] = methodFn;
+                pluginClass->methods[intern(entry.name)] = methodFn;
             }
 
             // Load plugin constants.
@@ -3313,20 +4793,20 @@ void processPluginLibrary(const std::string& libPath, VM& vm) {
                 }
             }
             // Define the plugin class in the environment.
-            vm.environment->define(toLower(pluginClass->name), Value(pluginClass));
-            debugLog("Loaded plugin class: " + pluginClass->name + " from " + libPath);
+            vm.environment->define(intern(pluginClass->name), Value(pluginClass));
+            DEBUG_TRACE(TRACE_PLUGIN, "Loaded plugin class: " + pluginClass->name + " from " + libPath);
 
             // Also register the event callback registration function.
             std::string setEventCallbackKey = toLower(pluginClass->name) + "_seteventcallback";
-            auto methodIt = pluginClass->methods.find(setEventCallbackKey);
+            auto methodIt = pluginClass->methods.find(intern(setEventCallbackKey));
             if (methodIt != pluginClass->methods.end()) {
                 vm.environment->define(setEventCallbackKey, methodIt->second);
-                debugLog("Registered event callback setter as global: " + setEventCallbackKey);
+                DEBUG_TRACE(TRACE_PLUGIN, "Registered event callback setter as global: " + setEventCallbackKey);
             } else {
-                debugLog("Warning: Event callback setter " + setEventCallbackKey + " not found in class methods.");
+                DEBUG_TRACE(TRACE_PLUGIN, "Warning: Event callback setter " + setEventCallbackKey + " not found in class methods.");
             }
         } else {
-            debugLog("Library " + libPath + " does not export GetPluginEntries or GetClassDefinition.");
+            DEBUG_TRACE(TRACE_PLUGIN, "Library " + libPath + " does not export GetPluginEntries or GetClassDefinition.");
         }
     }
 }
@@ -3348,12 +4828,12 @@ void loadPlugins(VM& vm) {
         } while (FindNextFileA(hFind, &findData));
         FindClose(hFind);
     } else {
-        debugLog("No plugins found in " + libsDir);
+        DEBUG_TRACE(TRACE_PLUGIN, "No plugins found in " + libsDir);
     }
 #else
     DIR* dir = opendir(libsDir.c_str());
     if (!dir) {
-        debugLog("Failed to open libs directory: " + libsDir);
+        DEBUG_TRACE(TRACE_PLUGIN, "Failed to open libs directory: " + libsDir);
         return;
     }
     struct dirent* entry;
@@ -3374,6 +4854,504 @@ void loadPlugins(VM& vm) {
 }
 
 
+// ============================================================================  
+// ConstantFolder – runs between Parser::parse() and Compiler::compile().
+// Evaluates operators whose operands are all literals, substitutes the value
+// of a Const wherever it is read, and drops a few identities (x * 1, x + 0,
+// x - 0, Not Not b). Each fold follows the VM's rule for that opcode exactly:
+// Integer op Integer stays Integer, a Double operand promotes the other. An
+// operation the VM would reject, or whose Integer result would overflow, is
+// left in place so it still happens (or fails) at run time.
+//
+// A Const is only substituted when its name is declared nowhere else (so no
+// local, parameter or field can shadow it), is never assigned to, and is
+// never passed bare to a function with ByRef parameters. Consts declared in a
+// module are substituted for bare reads inside that module and, if Public,
+// for Module.Name reads anywhere.
+// ============================================================================
+class ConstantFolder {
+public:
+    void fold(std::vector<std::shared_ptr<Stmt>>& program) {
+        scanStmts(program);
+        for (auto& use : bareArguments)
+            if (use.first.empty() || byRefCallees.count(use.first))
+                assigned.insert(use.second);
+        collectConsts(program);
+        foldStmts(program);
+    }
+
+private:
+    struct ModuleConst {
+        Value value;
+        bool isPublic = true;
+    };
+    std::unordered_map<std::string, int> declarations; // name -> times declared
+    std::unordered_set<std::string> assigned;
+    std::unordered_set<std::string> byRefCallees;
+    std::vector<std::pair<std::string, std::string>> bareArguments; // (callee, variable); callee "" if unknown
+    std::unordered_map<std::string, Value> globalConsts;
+    std::unordered_map<std::string, std::unordered_map<std::string, ModuleConst>> moduleConsts;
+    std::string currentModule;
+
+    // ---- Pass 1: declarations, assignments and ByRef uses -----------------
+
+    void declare(const std::string& name) { declarations[toLower(name)]++; }
+
+    void scanParams(const std::string& owner, const std::vector<Param>& params) {
+        for (const auto& p : params) {
+            declare(p.name);
+            if (p.byRef)
+                byRefCallees.insert(toLower(owner));
+        }
+    }
+
+    void scanStmts(const std::vector<std::shared_ptr<Stmt>>& stmts) {
+        for (const auto& s : stmts)
+            scanStmt(s);
+    }
+
+    void scanStmt(const std::shared_ptr<Stmt>& stmt) {
+        if (!stmt) return;
+        if (auto s = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) scanExpr(s->expression);
+        else if (auto s = std::dynamic_pointer_cast<ReturnStmt>(stmt)) scanExpr(s->value);
+        else if (auto s = std::dynamic_pointer_cast<FunctionStmt>(stmt)) {
+            declare(s->name);
+            scanParams(s->name, s->params);
+            scanStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<VarStmt>(stmt)) {
+            declare(s->name);
+            scanExpr(s->initializer);
+        }
+        else if (auto s = std::dynamic_pointer_cast<PropertyAssignmentStmt>(stmt)) {
+            scanExpr(s->object);
+            scanExpr(s->value);
+        }
+        else if (auto s = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+            declare(s->name);
+            for (const auto& prop : s->properties)
+                declare(prop.first);
+            for (const auto& m : s->methods)
+                scanStmt(m);
+        }
+        else if (auto s = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            scanExpr(s->condition);
+            scanStmts(s->thenBranch);
+            scanStmts(s->elseBranch);
+        }
+        else if (auto s = std::dynamic_pointer_cast<SelectStmt>(stmt)) {
+            scanExpr(s->selector);
+            for (const auto& clause : s->clauses) {
+                for (const auto& test : clause.tests) {
+                    scanExpr(test.value);
+                    scanExpr(test.upper);
+                }
+                scanStmts(clause.body);
+            }
+            scanStmts(s->elseBranch);
+        }
+        else if (auto s = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            scanExpr(s->condition);
+            scanStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<AssignmentStmt>(stmt)) {
+            assigned.insert(toLower(s->name));
+            scanExpr(s->value);
+        }
+        else if (auto s = std::dynamic_pointer_cast<BlockStmt>(stmt)) scanStmts(s->statements);
+        else if (auto s = std::dynamic_pointer_cast<ForStmt>(stmt)) {
+            assigned.insert(toLower(s->varName));
+            scanExpr(s->start);
+            scanExpr(s->end);
+            scanExpr(s->step);
+            scanStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<ModuleStmt>(stmt)) {
+            declare(s->name);
+            scanStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
+            declare(s->apiName);
+            scanParams(s->apiName, s->params);
+        }
+        else if (auto s = std::dynamic_pointer_cast<EnumStmt>(stmt)) declare(s->name);
+    }
+
+    void scanExpr(const std::shared_ptr<Expr>& expr) {
+        if (!expr) return;
+        if (auto e = std::dynamic_pointer_cast<UnaryExpr>(expr)) scanExpr(e->right);
+        else if (auto e = std::dynamic_pointer_cast<AssignmentExpr>(expr)) {
+            assigned.insert(toLower(e->name));
+            scanExpr(e->value);
+        }
+        else if (auto e = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+            scanExpr(e->left);
+            scanExpr(e->right);
+        }
+        else if (auto e = std::dynamic_pointer_cast<GroupingExpr>(expr)) scanExpr(e->expression);
+        else if (auto e = std::dynamic_pointer_cast<CallExpr>(expr)) {
+            std::string callee;
+            if (auto v = std::dynamic_pointer_cast<VariableExpr>(e->callee)) callee = toLower(v->name);
+            else if (auto g = std::dynamic_pointer_cast<GetPropExpr>(e->callee)) callee = g->name;
+            for (const auto& arg : e->arguments)
+                if (auto v = std::dynamic_pointer_cast<VariableExpr>(arg))
+                    bareArguments.emplace_back(callee, toLower(v->name));
+            scanExpr(e->callee);
+            for (const auto& arg : e->arguments)
+                scanExpr(arg);
+        }
+        else if (auto e = std::dynamic_pointer_cast<ArrayLiteralExpr>(expr)) {
+            for (const auto& el : e->elements)
+                scanExpr(el);
+        }
+        else if (auto e = std::dynamic_pointer_cast<GetPropExpr>(expr)) scanExpr(e->object);
+        else if (auto e = std::dynamic_pointer_cast<SetPropExpr>(expr)) {
+            scanExpr(e->object);
+            scanExpr(e->value);
+        }
+        else if (auto e = std::dynamic_pointer_cast<NewExpr>(expr)) {
+            for (const auto& arg : e->arguments)
+                scanExpr(arg);
+        }
+    }
+
+    // ---- Pass 2: Const values, in declaration order ------------------------
+
+    static bool isFoldable(const Value& v) {
+        return holds<int>(v) || holds<double>(v) || holds<std::string>(v) || holds<bool>(v);
+    }
+
+    void collectConsts(std::vector<std::shared_ptr<Stmt>>& stmts) {
+        for (auto& stmt : stmts) {
+            if (auto mod = std::dynamic_pointer_cast<ModuleStmt>(stmt)) {
+                std::string saved = currentModule;
+                currentModule = toLower(mod->name);
+                collectConsts(mod->body);
+                currentModule = saved;
+                continue;
+            }
+            auto var = std::dynamic_pointer_cast<VarStmt>(stmt);
+            if (!var || !var->isConstant || !var->initializer)
+                continue;
+            foldExpr(var->initializer);
+            auto lit = std::dynamic_pointer_cast<LiteralExpr>(var->initializer);
+            std::string key = toLower(var->name);
+            if (!lit || !isFoldable(lit->value) || declarations[key] != 1 || assigned.count(key))
+                continue;
+            if (currentModule.empty())
+                globalConsts[key] = lit->value;
+            else
+                moduleConsts[currentModule][key] = { lit->value, var->access == AccessModifier::PUBLIC };
+        }
+    }
+
+    // ---- Pass 3: fold every expression -------------------------------------
+
+    void foldStmts(std::vector<std::shared_ptr<Stmt>>& stmts) {
+        for (auto& s : stmts)
+            foldStmt(s);
+    }
+
+    void foldStmt(const std::shared_ptr<Stmt>& stmt) {
+        if (!stmt) return;
+        if (auto s = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) foldExpr(s->expression);
+        else if (auto s = std::dynamic_pointer_cast<ReturnStmt>(stmt)) foldExpr(s->value);
+        else if (auto s = std::dynamic_pointer_cast<FunctionStmt>(stmt)) foldStmts(s->body);
+        else if (auto s = std::dynamic_pointer_cast<VarStmt>(stmt)) foldExpr(s->initializer);
+        else if (auto s = std::dynamic_pointer_cast<PropertyAssignmentStmt>(stmt)) foldExpr(s->value);
+        else if (auto s = std::dynamic_pointer_cast<ClassStmt>(stmt)) {
+            for (auto& m : s->methods)
+                foldStmt(m);
+        }
+        else if (auto s = std::dynamic_pointer_cast<IfStmt>(stmt)) {
+            foldExpr(s->condition);
+            foldStmts(s->thenBranch);
+            foldStmts(s->elseBranch);
+        }
+        else if (auto s = std::dynamic_pointer_cast<SelectStmt>(stmt)) {
+            foldExpr(s->selector);
+            for (auto& clause : s->clauses) {
+                for (auto& test : clause.tests) {
+                    foldExpr(test.value);
+                    foldExpr(test.upper);
+                }
+                foldStmts(clause.body);
+            }
+            foldStmts(s->elseBranch);
+        }
+        else if (auto s = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
+            foldExpr(s->condition);
+            foldStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<AssignmentStmt>(stmt)) foldExpr(s->value);
+        else if (auto s = std::dynamic_pointer_cast<BlockStmt>(stmt)) foldStmts(s->statements);
+        else if (auto s = std::dynamic_pointer_cast<ForStmt>(stmt)) {
+            foldExpr(s->start);
+            foldExpr(s->end);
+            foldExpr(s->step);
+            foldStmts(s->body);
+        }
+        else if (auto s = std::dynamic_pointer_cast<ModuleStmt>(stmt)) {
+            std::string saved = currentModule;
+            currentModule = toLower(s->name);
+            foldStmts(s->body);
+            currentModule = saved;
+        }
+    }
+
+    bool lookupConst(const std::string& name, Value& out) {
+        std::string key = toLower(name);
+        if (!currentModule.empty()) {
+            auto mod = moduleConsts.find(currentModule);
+            if (mod != moduleConsts.end()) {
+                auto it = mod->second.find(key);
+                if (it != mod->second.end()) {
+                    out = it->second.value;
+                    return true;
+                }
+            }
+        }
+        auto it = globalConsts.find(key);
+        if (it == globalConsts.end())
+            return false;
+        out = it->second;
+        return true;
+    }
+
+    static std::shared_ptr<LiteralExpr> asLiteral(const std::shared_ptr<Expr>& e) {
+        return std::dynamic_pointer_cast<LiteralExpr>(e);
+    }
+
+    static bool isIntLiteral(const std::shared_ptr<Expr>& e, int value) {
+        auto lit = asLiteral(e);
+        return lit && holds<int>(lit->value) && valueRef<int>(lit->value) == value;
+    }
+
+    // Static result types, where the operator alone guarantees one.
+    static bool knownInt(const std::shared_ptr<Expr>& e) {
+        if (auto lit = asLiteral(e)) return holds<int>(lit->value);
+        if (auto g = std::dynamic_pointer_cast<GroupingExpr>(e)) return knownInt(g->expression);
+        if (auto u = std::dynamic_pointer_cast<UnaryExpr>(e)) return u->op == "-" && knownInt(u->right);
+        if (auto b = std::dynamic_pointer_cast<BinaryExpr>(e))
+            return (b->op == BinaryOp::ADD || b->op == BinaryOp::SUB ||
+                    b->op == BinaryOp::MUL || b->op == BinaryOp::MOD) &&
+                   knownInt(b->left) && knownInt(b->right);
+        return false;
+    }
+
+    static bool knownNumber(const std::shared_ptr<Expr>& e) {
+        if (auto lit = asLiteral(e)) return holds<int>(lit->value) || holds<double>(lit->value);
+        if (auto g = std::dynamic_pointer_cast<GroupingExpr>(e)) return knownNumber(g->expression);
+        if (auto u = std::dynamic_pointer_cast<UnaryExpr>(e)) return u->op == "-";
+        if (auto b = std::dynamic_pointer_cast<BinaryExpr>(e))
+            return b->op == BinaryOp::SUB || b->op == BinaryOp::MUL || b->op == BinaryOp::DIV ||
+                   b->op == BinaryOp::POW || b->op == BinaryOp::MOD || knownInt(e);
+        return false;
+    }
+
+    static bool knownBool(const std::shared_ptr<Expr>& e) {
+        if (auto lit = asLiteral(e)) return holds<bool>(lit->value);
+        if (auto g = std::dynamic_pointer_cast<GroupingExpr>(e)) return knownBool(g->expression);
+        if (auto u = std::dynamic_pointer_cast<UnaryExpr>(e)) return u->op == "not" && knownBool(u->right);
+        if (auto b = std::dynamic_pointer_cast<BinaryExpr>(e))
+            switch (b->op) {
+            case BinaryOp::LT: case BinaryOp::LE: case BinaryOp::GT: case BinaryOp::GE:
+            case BinaryOp::EQ: case BinaryOp::NE: case BinaryOp::AND: case BinaryOp::OR:
+                return true;
+            default:
+                return false;
+            }
+        return false;
+    }
+
+    static bool fitsInt(long long v) {
+        return v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max();
+    }
+
+    static double toDouble(const Value& v) {
+        return holds<double>(v) ? valueRef<double>(v) : static_cast<double>(valueRef<int>(v));
+    }
+
+    static bool foldUnary(const std::string& op, const Value& v, Value& out) {
+        if (op == "-") {
+            if (holds<int>(v) && valueRef<int>(v) != std::numeric_limits<int>::min()) { out = Value(-valueRef<int>(v)); return true; }
+            if (holds<double>(v)) { out = Value(-valueRef<double>(v)); return true; }
+            return false;
+        }
+        if (holds<bool>(v)) { out = Value(!valueRef<bool>(v)); return true; }
+        if (holds<int>(v))  { out = Value(~valueRef<int>(v)); return true; }
+        if (holds<double>(v)) {
+            double ipart;
+            if (std::modf(valueRef<double>(v), &ipart) == 0.0 &&
+                ipart >= (double)std::numeric_limits<int>::min() &&
+                ipart <= (double)std::numeric_limits<int>::max()) {
+                out = Value(~(int)ipart);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Mirrors the VM case for each opcode; see the class comment.
+    static bool foldBinary(BinaryOp op, const Value& a, const Value& b, Value& out) {
+        bool ints = holds<int>(a) && holds<int>(b);
+        bool numbers = (holds<int>(a) || holds<double>(a)) && (holds<int>(b) || holds<double>(b));
+        long long x = ints ? valueRef<int>(a) : 0, y = ints ? valueRef<int>(b) : 0;
+        switch (op) {
+        case BinaryOp::ADD:
+            if (holds<std::string>(a) && holds<std::string>(b)) {
+                out = Value(valueRef<std::string>(a) + valueRef<std::string>(b));
+                return true;
+            }
+            if (ints) { if (!fitsInt(x + y)) return false; out = Value((int)(x + y)); return true; }
+            if (numbers) { out = Value(toDouble(a) + toDouble(b)); return true; }
+            return false;
+        case BinaryOp::SUB:
+            if (ints) { if (!fitsInt(x - y)) return false; out = Value((int)(x - y)); return true; }
+            if (numbers) { out = Value(toDouble(a) - toDouble(b)); return true; }
+            return false;
+        case BinaryOp::MUL:
+            if (ints) { if (!fitsInt(x * y)) return false; out = Value((int)(x * y)); return true; }
+            if (numbers) { out = Value(toDouble(a) * toDouble(b)); return true; }
+            return false;
+        case BinaryOp::DIV:
+            if (!numbers) return false;
+            out = Value(toDouble(a) / toDouble(b));
+            return true;
+        case BinaryOp::POW:
+            if (!numbers) return false;
+            out = Value(std::pow(toDouble(a), toDouble(b)));
+            return true;
+        case BinaryOp::MOD:
+            if (ints) {
+                if (y == 0 || (x == std::numeric_limits<int>::min() && y == -1)) return false;
+                out = Value((int)(x % y));
+                return true;
+            }
+            if (numbers) { out = Value(std::fmod(toDouble(a), toDouble(b))); return true; }
+            return false;
+        case BinaryOp::LT: case BinaryOp::LE: case BinaryOp::GT: case BinaryOp::GE: {
+            if (!numbers) return false;
+            double l = toDouble(a), r = toDouble(b);
+            bool result;
+            if (ints)
+                result = op == BinaryOp::LT ? x < y : op == BinaryOp::LE ? x <= y : op == BinaryOp::GT ? x > y : x >= y;
+            else
+                result = op == BinaryOp::LT ? l < r : op == BinaryOp::LE ? l <= r : op == BinaryOp::GT ? l > r : l >= r;
+            out = Value(result);
+            return true;
+        }
+        case BinaryOp::EQ: case BinaryOp::NE: {
+            bool equal;
+            if (ints) equal = x == y;
+            else if (numbers) equal = toDouble(a) == toDouble(b);
+            else if (holds<bool>(a) && holds<bool>(b)) equal = valueRef<bool>(a) == valueRef<bool>(b);
+            else if (holds<std::string>(a) && holds<std::string>(b)) equal = valueRef<std::string>(a) == valueRef<std::string>(b);
+            else return false;
+            out = Value(op == BinaryOp::EQ ? equal : !equal);
+            return true;
+        }
+        case BinaryOp::AND: case BinaryOp::OR: {
+            auto truth = [](const Value& v, bool& t) {
+                if (holds<bool>(v)) { t = valueRef<bool>(v); return true; }
+                if (holds<int>(v))  { t = valueRef<int>(v) != 0; return true; }
+                return false;
+            };
+            bool l, r;
+            if (!truth(a, l) || !truth(b, r)) return false;
+            out = Value(op == BinaryOp::AND ? (l && r) : (l || r));
+            return true;
+        }
+        case BinaryOp::XOR:
+            if (holds<bool>(a) && holds<bool>(b)) { out = Value(valueRef<bool>(a) != valueRef<bool>(b)); return true; }
+            if (ints) { out = Value((int)(x ^ y)); return true; }
+            return false;
+        }
+        return false;
+    }
+
+    void foldExpr(std::shared_ptr<Expr>& expr) {
+        if (!expr) return;
+        if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
+            Value v;
+            if (lookupConst(var->name, v))
+                expr = std::make_shared<LiteralExpr>(v);
+        }
+        else if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
+            foldExpr(un->right);
+            Value v;
+            if (auto lit = asLiteral(un->right)) {
+                if (foldUnary(un->op, lit->value, v))
+                    expr = std::make_shared<LiteralExpr>(v);
+            }
+            else if (un->op == "not") {
+                // Not Not b is b for a Boolean or Integer b (~~i == i).
+                auto inner = std::dynamic_pointer_cast<UnaryExpr>(un->right);
+                if (inner && inner->op == "not" && (knownBool(inner->right) || knownInt(inner->right)))
+                    expr = inner->right;
+            }
+        }
+        else if (auto assign = std::dynamic_pointer_cast<AssignmentExpr>(expr)) foldExpr(assign->value);
+        else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+            foldExpr(bin->left);
+            foldExpr(bin->right);
+            auto l = asLiteral(bin->left), r = asLiteral(bin->right);
+            Value v;
+            if (l && r) {
+                if (foldBinary(bin->op, l->value, r->value, v))
+                    expr = std::make_shared<LiteralExpr>(v);
+            }
+            // x * 1 leaves any number unchanged; x + 0 only an Integer
+            // (-0.0 + 0 is +0.0); x - 0 any number.
+            else if (bin->op == BinaryOp::MUL && isIntLiteral(bin->right, 1) && knownNumber(bin->left))
+                expr = bin->left;
+            else if (bin->op == BinaryOp::MUL && isIntLiteral(bin->left, 1) && knownNumber(bin->right))
+                expr = bin->right;
+            else if (bin->op == BinaryOp::ADD && isIntLiteral(bin->right, 0) && knownInt(bin->left))
+                expr = bin->left;
+            else if (bin->op == BinaryOp::ADD && isIntLiteral(bin->left, 0) && knownInt(bin->right))
+                expr = bin->right;
+            else if (bin->op == BinaryOp::SUB && isIntLiteral(bin->right, 0) && knownNumber(bin->left))
+                expr = bin->left;
+        }
+        else if (auto group = std::dynamic_pointer_cast<GroupingExpr>(expr)) {
+            foldExpr(group->expression);
+            if (asLiteral(group->expression))
+                expr = group->expression;
+        }
+        else if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
+            // A bare callee name is left alone: the compiler resolves it.
+            if (!std::dynamic_pointer_cast<VariableExpr>(call->callee))
+                foldExpr(call->callee);
+            for (auto& arg : call->arguments)
+                foldExpr(arg);
+        }
+        else if (auto arr = std::dynamic_pointer_cast<ArrayLiteralExpr>(expr)) {
+            for (auto& el : arr->elements)
+                foldExpr(el);
+        }
+        else if (auto get = std::dynamic_pointer_cast<GetPropExpr>(expr)) {
+            if (auto var = std::dynamic_pointer_cast<VariableExpr>(get->object)) {
+                std::string mod = toLower(var->name);
+                auto it = moduleConsts.find(mod);
+                if (it != moduleConsts.end() && declarations[mod] == 1) {
+                    auto m = it->second.find(get->name);
+                    if (m != it->second.end() && (m->second.isPublic || mod == currentModule)) {
+                        expr = std::make_shared<LiteralExpr>(m->second.value);
+                        return;
+                    }
+                }
+            }
+            foldExpr(get->object);
+        }
+        else if (auto set = std::dynamic_pointer_cast<SetPropExpr>(expr)) foldExpr(set->value);
+        else if (auto n = std::dynamic_pointer_cast<NewExpr>(expr)) {
+            for (auto& arg : n->arguments)
+                foldExpr(arg);
+        }
+    }
+};
+
 // ============================================================================  
 // Compiler
 // ============================================================================
@@ -3383,23 +5361,35 @@ public:
     void compile(const std::vector<std::shared_ptr<Stmt>>& stmts) {
         for (auto stmt : stmts) {
             compileStmt(stmt, vm.mainChunk);
-            debugLog("Compiler: Compiled a statement. Main chunk now has " +
+            DEBUG_TRACE(TRACE_COMPILER, "Compiler: Compiled a statement. Main chunk now has " +
                 std::to_string(vm.mainChunk.code.size()) + " instructions.");
         }
         // patch unresolved gotos in main chunk
         for (auto& f : gotoFixups) {
             if (labelTable.find(f.label) == labelTable.end())
                 runtimeError("Undefined label: " + f.label);
-            vm.mainChunk.code[f.patchIndex] = labelTable[f.label];
+            patchJump(vm.mainChunk, f.patchIndex, labelTable[f.label]);
         }
         labelTable.clear();
         gotoFixups.clear();
+        // Every chunk ends in a return, so the VM never has to bounds-check ip.
+        emit(vm.mainChunk, OP_NIL);
+        emit(vm.mainChunk, OP_RETURN);
+        if (OPTIMIZE_LEVEL > 0)
+            optimizeChunk(vm.mainChunk);
+        vm.mainLocalCount = localCount;
+        // The chunks keep their own references; the pool is only needed
+        // while compiling.
+        sharedConstants.clear();
     }
 private:
     VM& vm;
+    // One Value per distinct pooled constant, shared by every chunk this
+    // compiler emits (see addConstant).
+    std::unordered_map<std::string, Value> sharedConstants;
     bool compilingModule; // Flag indicating if compiling a module
     std::string currentModuleName; // Current module name
-    std::unordered_map<std::string, Value> currentModulePublicMembers;  // Public members of current module
+    std::unordered_map<Symbol, Value> currentModulePublicMembers;  // Public members of current module
 
     //
     struct Fixup { std::string label; int patchIndex; };
@@ -3407,13 +5397,380 @@ private:
     std::vector<Fixup> gotoFixups;
     //
 
+    // Enum members seen so far, so Select Case can key its jump table on them.
+    std::unordered_map<std::string, std::unordered_map<std::string, int>> declaredEnums;
+
+    // Local slot resolution for the function body being compiled. Parameters
+    // and Dim'd locals become OP_GET_LOCAL/OP_SET_LOCAL; everything else
+    // (globals, module members, implicit self fields) stays name-based.
+    bool compilingFunction = false;
+    std::unordered_map<std::string, int> localSlots;
+    int localCount = 0;
+    // ByRef parameters of that function; their slots hold an ObjRef to a
+    // caller's variable, which script calls can reach like a global.
+    std::unordered_set<std::string> byRefLocals;
+
+    int resolveLocal(const std::string& name) const {
+        if (!compilingFunction) return -1;
+        auto it = localSlots.find(toLower(name));
+        return (it != localSlots.end()) ? it->second : -1;
+    }
+
+    int declareLocal(const std::string& name) {
+        std::string key = toLower(name);
+        auto it = localSlots.find(key);
+        if (it != localSlots.end()) return it->second;
+        localSlots[key] = localCount;
+        return localCount++;
+    }
+
+    // Where the most recent OP_CALL was emitted, for spotting Return f(args).
+    struct { ObjFunction::CodeChunk* chunk; int pos; } lastCall = { nullptr, -1 };
+
+    static int operandSize(const ObjFunction::CodeChunk& chunk, int pos) {
+        int end = pos;
+        readOperand(chunk.code.data(), end);
+        return end - pos;
+    }
+
+    // Reserves unnamed slots in the current frame (a function, or top-level
+    // code when not compiling one) and returns the first.
+    int reserveSlots(int count) {
+        int first = localCount;
+        localCount += count;
+        return first;
+    }
+
+    // Pushes an ObjRef to a variable's cell (local slot or global).
+    void emitVariableRef(ObjFunction::CodeChunk& chunk, const std::string& name) {
+        int slot = resolveLocal(name);
+        if (slot >= 0) {
+            emitWithOperand(chunk, OP_GET_LOCAL_REF, slot);
+        } else {
+            emitWithOperand(chunk, OP_GET_REF, intern(name));
+        }
+    }
+
+    void emitSetVariable(ObjFunction::CodeChunk& chunk, const std::string& name) {
+        int slot = resolveLocal(name);
+        if (slot >= 0) {
+            emitWithOperand(chunk, OP_SET_LOCAL, slot);
+        } else {
+            emitWithOperand(chunk, OP_SET_GLOBAL, intern(name));
+        }
+    }
+
+    // True when evaluating `expr` can neither read nor write the variable
+    // `key` (already case-folded). Locals can only be reached by naming them;
+    // a global, self field or ByRef parameter can also be changed by any
+    // script call, so only builtin calls are allowed there.
+    bool appendPieceIsSafe(const std::shared_ptr<Expr>& expr, const std::string& key, bool targetIsLocal) {
+        if (std::dynamic_pointer_cast<LiteralExpr>(expr))
+            return true;
+        if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr))
+            return toLower(var->name) != key;
+        if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr))
+            return appendPieceIsSafe(un->right, key, targetIsLocal);
+        if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr))
+            return appendPieceIsSafe(bin->left, key, targetIsLocal) &&
+                   appendPieceIsSafe(bin->right, key, targetIsLocal);
+        if (auto group = std::dynamic_pointer_cast<GroupingExpr>(expr))
+            return appendPieceIsSafe(group->expression, key, targetIsLocal);
+        if (auto get = std::dynamic_pointer_cast<GetPropExpr>(expr))
+            return appendPieceIsSafe(get->object, key, targetIsLocal);
+        if (auto call = std::dynamic_pointer_cast<CallExpr>(expr)) {
+            if (!targetIsLocal) {
+                auto calleeVar = std::dynamic_pointer_cast<VariableExpr>(call->callee);
+                Value raw;
+                if (!calleeVar || resolveLocal(calleeVar->name) >= 0 ||
+                    !vm.environment->tryGetRaw(calleeVar->name, raw) || !holds<BuiltinFn>(raw))
+                    return false;
+            }
+            if (!appendPieceIsSafe(call->callee, key, targetIsLocal))
+                return false;
+            for (auto& arg : call->arguments)
+                if (!appendPieceIsSafe(arg, key, targetIsLocal))
+                    return false;
+            return true;
+        }
+        return false;
+    }
+
+    // `name = name + a + b ...` compiles to the pieces followed by
+    // OP_APPEND_LOCAL/OP_APPEND_GLOBAL, which extends name's string in place
+    // rather than copying it on every assignment. Emits nothing and returns
+    // false when the value doesn't have that shape or a piece could observe
+    // the variable mid-update.
+    bool compileAppend(ObjFunction::CodeChunk& chunk, const std::string& name, const std::shared_ptr<Expr>& value) {
+        std::vector<std::shared_ptr<Expr>> pieces;
+        std::shared_ptr<Expr> head = value;
+        for (;;) {
+            if (auto group = std::dynamic_pointer_cast<GroupingExpr>(head)) {
+                head = group->expression;
+                continue;
+            }
+            auto bin = std::dynamic_pointer_cast<BinaryExpr>(head);
+            if (!bin || bin->op != BinaryOp::ADD)
+                break;
+            pieces.push_back(bin->right);
+            head = bin->left;
+        }
+        auto headVar = std::dynamic_pointer_cast<VariableExpr>(head);
+        std::string key = toLower(name);
+        if (pieces.empty() || !headVar || toLower(headVar->name) != key)
+            return false;
+
+        int slot = resolveLocal(name);
+        bool targetIsLocal = slot >= 0 && !byRefLocals.count(key);
+        for (auto& piece : pieces)
+            if (!appendPieceIsSafe(piece, key, targetIsLocal))
+                return false;
+
+        for (auto it = pieces.rbegin(); it != pieces.rend(); ++it)
+            compileExpr(*it, chunk);
+        if (slot >= 0)
+            emitWithOperand(chunk, OP_APPEND_LOCAL, slot);
+        else
+            emitWithOperand(chunk, OP_APPEND_GLOBAL, intern(name));
+        emitOperand(chunk, (int)pieces.size());
+        return true;
+    }
+
+    int addConstant(ObjFunction::CodeChunk& chunk, const Value& v) {
+        std::string key;
+        if (!constantKey(v, key)) {
+            chunk.constants.push_back(v);
+            return chunk.constants.size() - 1;
+        }
+        auto it = chunk.constantIndex.find(key);
+        if (it != chunk.constantIndex.end())
+            return it->second;
+        int index = chunk.constants.size();
+        chunk.constants.push_back(sharedConstants.emplace(key, v).first->second);
+        chunk.constantIndex.emplace(std::move(key), index);
+        return index;
+    }
+
+    int addConstantString(ObjFunction::CodeChunk& chunk, const std::string& s) {
+        return addConstant(chunk, Value(s));
+    }
+
     void emit(ObjFunction::CodeChunk& chunk, int byte) {
-        chunk.code.push_back(byte);
+        chunk.code.push_back((uint8_t)byte);
+    }
+
+    void emitOperand(ObjFunction::CodeChunk& chunk, int operand) {
+        unsigned v = (unsigned)operand;
+        while (v >= 0x80) {
+            emit(chunk, (v & 0x7F) | 0x80);
+            v >>= 7;
+        }
+        emit(chunk, v);
     }
 
     void emitWithOperand(ObjFunction::CodeChunk& chunk, int opcode, int operand) {
         emit(chunk, opcode);
-        emit(chunk, operand);
+        emitOperand(chunk, operand);
+    }
+
+    // GET/SET_PROPERTY carry the name constant and a fresh inline-cache slot.
+    void emitPropertyOp(ObjFunction::CodeChunk& chunk, int opcode, Symbol name) {
+        emitWithOperand(chunk, opcode, name);
+        emitOperand(chunk, (int)chunk.propertyCaches.size());
+        chunk.propertyCaches.emplace_back();
+    }
+
+    // OP_INVOKE name argc cache – like emitPropertyOp, plus the argument count.
+    void emitInvoke(ObjFunction::CodeChunk& chunk, Symbol name, int argCount) {
+        emitWithOperand(chunk, OP_INVOKE, name);
+        emitOperand(chunk, argCount);
+        emitOperand(chunk, (int)chunk.propertyCaches.size());
+        chunk.propertyCaches.emplace_back();
+    }
+
+    // Emits a jump target field and returns its offset for patchJump.
+    int emitJumpTarget(ObjFunction::CodeChunk& chunk, int target = 0) {
+        int pos = (int)chunk.code.size();
+        chunk.code.resize(pos + JUMP_OPERAND_SIZE);
+        patchJump(chunk, pos, target);
+        return pos;
+    }
+
+    int emitJump(ObjFunction::CodeChunk& chunk, int opcode, int target = 0) {
+        emit(chunk, opcode);
+        return emitJumpTarget(chunk, target);
+    }
+
+    void patchJump(ObjFunction::CodeChunk& chunk, int pos, int target) {
+        uint32_t t = (uint32_t)target;
+        std::memcpy(&chunk.code[pos], &t, JUMP_OPERAND_SIZE);
+    }
+
+    static int binaryOpcode(BinaryOp op) {
+        switch (op) {
+        case BinaryOp::ADD: return OP_ADD;
+        case BinaryOp::SUB: return OP_SUB;
+        case BinaryOp::MUL: return OP_MUL;
+        case BinaryOp::DIV: return OP_DIV;
+        case BinaryOp::LT:  return OP_LT;
+        case BinaryOp::LE:  return OP_LE;
+        case BinaryOp::GT:  return OP_GT;
+        case BinaryOp::GE:  return OP_GE;
+        case BinaryOp::NE:  return OP_NE;
+        case BinaryOp::EQ:  return OP_EQ;
+        case BinaryOp::AND: return OP_AND;
+        case BinaryOp::OR:  return OP_OR;
+        case BinaryOp::XOR: return OP_XOR;
+        case BinaryOp::POW: return OP_POW;
+        case BinaryOp::MOD: return OP_MOD;
+        }
+        return OP_EQ;
+    }
+
+    // A Case value the jump table can key on: an Integer or String literal,
+    // or a member of an Enum declared earlier in the script.
+    bool caseConstant(const std::shared_ptr<Expr>& expr, Value& out) {
+        if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(expr)) {
+            if (!holds<int>(lit->value) && !holds<std::string>(lit->value))
+                return false;
+            out = lit->value;
+            return true;
+        }
+        if (auto get = std::dynamic_pointer_cast<GetPropExpr>(expr)) {
+            auto var = std::dynamic_pointer_cast<VariableExpr>(get->object);
+            if (!var || resolveLocal(var->name) >= 0)
+                return false;
+            auto e = declaredEnums.find(toLower(var->name));
+            if (e == declaredEnums.end())
+                return false;
+            auto m = e->second.find(get->name);
+            if (m == e->second.end())
+                return false;
+            out = Value(m->second);
+            return true;
+        }
+        return false;
+    }
+
+    // Select Case. When every test is a constant of one kind (Integer/Enum or
+    // String) the selector is handed straight to OP_SWITCH. Otherwise it is
+    // stored once in a hidden slot and the tests are compared against it in
+    // order; each test uses the ordinary comparison opcodes, so the matching
+    // rules are those of `=`, `<`, etc.
+    void compileSelect(const std::shared_ptr<SelectStmt>& sel, ObjFunction::CodeChunk& chunk) {
+        compileExpr(sel->selector, chunk);
+
+        std::vector<std::vector<Value>> keys;
+        bool useTable = !sel->clauses.empty();
+        bool stringKeys = false, sawKey = false;
+        for (const auto& clause : sel->clauses) {
+            keys.emplace_back();
+            for (const auto& test : clause.tests) {
+                Value key;
+                if (!useTable || test.kind != SelectStmt::CaseTest::VALUE || !caseConstant(test.value, key)) {
+                    useTable = false;
+                    break;
+                }
+                bool isString = holds<std::string>(key);
+                if (!sawKey)
+                    stringKeys = isString;
+                else if (isString != stringKeys)
+                    useTable = false;
+                sawKey = true;
+                keys.back().push_back(key);
+            }
+        }
+
+        std::vector<int> endJumps;
+        if (useTable) {
+            int tableIndex = (int)chunk.switchTables.size();
+            chunk.switchTables.emplace_back();
+            emitWithOperand(chunk, OP_SWITCH, tableIndex);
+
+            std::vector<int> bodyStarts;
+            for (const auto& clause : sel->clauses) {
+                bodyStarts.push_back((int)chunk.code.size());
+                for (auto s : clause.body)
+                    compileStmt(s, chunk);
+                endJumps.push_back(emitJump(chunk, OP_JUMP));
+            }
+            int defaultTarget = (int)chunk.code.size();
+            for (auto s : sel->elseBranch)
+                compileStmt(s, chunk);
+
+            SwitchTable& table = chunk.switchTables[tableIndex];
+            table.defaultTarget = defaultTarget;
+            // The first Case listing a value wins, as it would in a linear scan.
+            if (stringKeys) {
+                for (size_t c = 0; c < keys.size(); c++)
+                    for (const auto& k : keys[c])
+                        table.strings.emplace(valueRef<std::string>(k), bodyStarts[c]);
+            } else {
+                long long lo = std::numeric_limits<int>::max(), hi = std::numeric_limits<int>::min();
+                size_t count = 0;
+                for (const auto& clauseKeys : keys)
+                    for (const auto& k : clauseKeys) {
+                        lo = std::min<long long>(lo, valueRef<int>(k));
+                        hi = std::max<long long>(hi, valueRef<int>(k));
+                        count++;
+                    }
+                bool dense = hi - lo < 2 * (long long)count + 16;
+                if (dense) {
+                    table.low = (int)lo;
+                    table.dense.assign((size_t)(hi - lo + 1), -1);
+                }
+                for (size_t c = 0; c < keys.size(); c++)
+                    for (const auto& k : keys[c]) {
+                        int key = valueRef<int>(k);
+                        if (!dense)
+                            table.sparse.emplace(key, bodyStarts[c]);
+                        else if (table.dense[(size_t)(key - table.low)] < 0)
+                            table.dense[(size_t)(key - table.low)] = bodyStarts[c];
+                    }
+            }
+        } else {
+            int slot = reserveSlots(1);
+            emitWithOperand(chunk, OP_DEFINE_LOCAL, slot);
+            for (const auto& clause : sel->clauses) {
+                // Every test but the last jumps into the body on success;
+                // the last one falls into it and skips the clause on failure.
+                std::vector<int> bodyJumps, nextClauseJumps;
+                for (size_t t = 0; t < clause.tests.size(); t++) {
+                    const auto& test = clause.tests[t];
+                    std::vector<int> failJumps;
+                    emitWithOperand(chunk, OP_GET_LOCAL, slot);
+                    compileExpr(test.value, chunk);
+                    if (test.kind == SelectStmt::CaseTest::RANGE) {
+                        emit(chunk, OP_GE);
+                        failJumps.push_back(emitJump(chunk, OP_JUMP_IF_FALSE));
+                        emitWithOperand(chunk, OP_GET_LOCAL, slot);
+                        compileExpr(test.upper, chunk);
+                        emit(chunk, OP_LE);
+                    } else {
+                        emit(chunk, binaryOpcode(test.kind == SelectStmt::CaseTest::IS ? test.op : BinaryOp::EQ));
+                    }
+                    failJumps.push_back(emitJump(chunk, OP_JUMP_IF_FALSE));
+                    if (t + 1 == clause.tests.size()) {
+                        nextClauseJumps = failJumps;
+                    } else {
+                        bodyJumps.push_back(emitJump(chunk, OP_JUMP));
+                        for (int j : failJumps)
+                            patchJump(chunk, j, (int)chunk.code.size());
+                    }
+                }
+                for (int j : bodyJumps)
+                    patchJump(chunk, j, (int)chunk.code.size());
+                for (auto s : clause.body)
+                    compileStmt(s, chunk);
+                endJumps.push_back(emitJump(chunk, OP_JUMP));
+                for (int j : nextClauseJumps)
+                    patchJump(chunk, j, (int)chunk.code.size());
+            }
+            for (auto s : sel->elseBranch)
+                compileStmt(s, chunk);
+        }
+        for (int j : endJumps)
+            patchJump(chunk, j, (int)chunk.code.size());
     }
 
     void compileStmt(std::shared_ptr<Stmt> stmt, ObjFunction::CodeChunk& chunk) {
@@ -3432,7 +5789,7 @@ private:
             moduleObj->publicMembers = currentModulePublicMembers;
             vm.environment = previousEnv;
             compilingModule = oldCompilingModule;
-            vm.environment->define(toLower(currentModuleName), Value(moduleObj));
+            vm.environment->define(intern(currentModuleName), Value(moduleObj));
             for (auto& entry : currentModulePublicMembers) {
                 vm.environment->define(entry.first, entry.second);
             }
@@ -3443,9 +5800,8 @@ private:
             labelTable[label->name] = chunk.code.size();
         }
         else if (auto gs = std::dynamic_pointer_cast<GotoStmt>(stmt)) {
-            int pos = chunk.code.size();
-            emitWithOperand(chunk, OP_JUMP, 0);           // placeholder
-            gotoFixups.push_back({ gs->label, pos + 1 }); // operand cell to patch
+            int pos = emitJump(chunk, OP_JUMP);           // placeholder
+            gotoFixups.push_back({ gs->label, pos });     // operand cell to patch
         }
         else if (auto declStmt = std::dynamic_pointer_cast<DeclareStmt>(stmt)) {
             compileDeclare(declStmt, chunk);
@@ -3454,24 +5810,35 @@ private:
             auto enumObj = std::make_shared<ObjEnum>();
             enumObj->name = toLower(enumStmt->name);
             enumObj->members = enumStmt->members;
+            declaredEnums[enumObj->name] = enumObj->members;
             if (!compilingModule) {
-                int nameConst = addConstantString(chunk, toLower(enumStmt->name));
                 int enumConstant = addConstant(chunk, Value(enumObj));
                 emitWithOperand(chunk, OP_CONSTANT, enumConstant);
-                emitWithOperand(chunk, OP_DEFINE_GLOBAL, nameConst);
+                emitWithOperand(chunk, OP_DEFINE_GLOBAL, intern(enumStmt->name));
             }
             else {
-                currentModulePublicMembers[toLower(enumStmt->name)] = Value(enumObj);
-                vm.environment->define(toLower(enumStmt->name), Value(enumObj));
+                currentModulePublicMembers[intern(enumStmt->name)] = Value(enumObj);
+                vm.environment->define(intern(enumStmt->name), Value(enumObj));
             }
         }
         else if (auto exprStmt = std::dynamic_pointer_cast<ExpressionStmt>(stmt)) {
+            // `s += x` parses as an assignment expression; as a statement its
+            // value is unused, so it can take the in-place append path too.
+            if (auto assignExpr = std::dynamic_pointer_cast<AssignmentExpr>(exprStmt->expression))
+                if (compileAppend(chunk, assignExpr->name, assignExpr->value))
+                    return;
             compileExpr(exprStmt->expression, chunk);
             emit(chunk, OP_POP);
         }
         else if (auto retStmt = std::dynamic_pointer_cast<ReturnStmt>(stmt)) {
-            if (retStmt->value)
+            if (retStmt->value) {
+                lastCall = { nullptr, -1 };
                 compileExpr(retStmt->value, chunk);
+                // Return f(args): the call is the last thing the value does.
+                if (compilingFunction && lastCall.chunk == &chunk &&
+                    lastCall.pos + 1 + operandSize(chunk, lastCall.pos + 1) == (int)chunk.code.size())
+                    chunk.code[lastCall.pos] = OP_TAIL_CALL;
+            }
             else
                 emit(chunk, OP_NIL);
             emit(chunk, OP_RETURN);
@@ -3510,14 +5877,13 @@ private:
 
 
                 // (b) Grab the compiled function Value
-                Value fnVal = vm.environment->get(toLower(funcStmt->name));
+                Value fnVal = vm.environment->get(intern(funcStmt->name));
                 // (c) Wrap it so that calls insert the receiver as the first argument
                 std::string extName = funcStmt->name;              // <-- capture the name
 
                 BuiltinFn extWrapper =
-                        [fnVal,
-                        receiverName = funcStmt->extendedParam]   // capture “a” in Extends a As …
-                        (const std::vector<Value>& args) -> Value
+                        [fnVal]
+                        (ArgSpan args) -> Value
                     {
                         /* args[0] is the receiver, args[1…] are the regular parameters */
 
@@ -3536,22 +5902,12 @@ private:
                                         std::to_string(required) + " and " + std::to_string(total) +
                                         " argument(s) after the receiver.");
 
-                        VM temp;
-                        temp.globals     = std::make_shared<Environment>();
-                        temp.environment = temp.globals;
+                        if (!globalVM) runtimeError("No active VM for extension call.");
 
-                        /* 1. bind the receiver (“a” in the user’s code) */
-                        temp.environment->define(receiverName, args[0]);
-
-                        /* 2. bind the declared parameters */
-                        for (size_t i = 0; i < fn->params.size(); ++i) {
-                            Value actual = (i + 1 < args.size())
-                                        ? args[i + 1]
-                                        : fn->params[i].defaultValue;
-                            temp.environment->define(fn->params[i].name, actual);
-                        }
-
-                        return runVM(temp, fn->chunk);
+                        /* the receiver (“a” in the user’s code) takes slot 0,
+                           the declared parameters follow */
+                        std::vector<Value> params(args.begin() + 1, args.end());
+                        return runFunction(*globalVM, fn, params, args[0]);
                     };
 
 
@@ -3563,14 +5919,14 @@ private:
                 // = Value(extWrapper);
                 vm.extensionMethods
                 [ canonicalExtTypeName(funcStmt->extendedType) ]
-                [ toLower(funcStmt->name) ]
+                [ intern(funcStmt->name) ]
                 = Value(extWrapper);
 
 
                 // ── NEW: export public extension methods out of the module ──────────
                 if (compilingModule && funcStmt->access == AccessModifier::PUBLIC) {
-                    currentModulePublicMembers[toLower(funcStmt->name)] =
-                        vm.environment->get(toLower(funcStmt->name));
+                    currentModulePublicMembers[intern(funcStmt->name)] =
+                        vm.environment->get(intern(funcStmt->name));
                 }
                 // (e) Don’t emit a DEFINE_GLOBAL for extension methods
                 return;
@@ -3602,17 +5958,16 @@ private:
 
             if (!compilingModule) {
                 // Emit as a global
-                int fnConst   = addConstant(chunk, vm.environment->get(toLower(funcStmt->name)));
+                int fnConst   = addConstant(chunk, vm.environment->get(intern(funcStmt->name)));
                 emitWithOperand(chunk, OP_CONSTANT, fnConst);
-                int nameConst = addConstantString(chunk, toLower(funcStmt->name));
-                emitWithOperand(chunk, OP_DEFINE_GLOBAL, nameConst);
+                emitWithOperand(chunk, OP_DEFINE_GLOBAL, intern(funcStmt->name));
             }
             else {
                 // Module‑scoped
                 if (funcStmt->access == AccessModifier::PUBLIC) {
                     currentModulePublicMembers
-                    [ toLower(funcStmt->name) ]
-                    = vm.environment->get(toLower(funcStmt->name));
+                    [ intern(funcStmt->name) ]
+                    = vm.environment->get(intern(funcStmt->name));
                 }
             }
         }
@@ -3640,16 +5995,18 @@ private:
                 else
                     compileExpr(std::make_shared<LiteralExpr>(std::monostate{}), chunk);
             }
-            if (!compilingModule) {
-                int nameConst = addConstantString(chunk, toLower(varStmt->name));
-                emitWithOperand(chunk, OP_DEFINE_GLOBAL, nameConst);
+            if (compilingFunction) {
+                emitWithOperand(chunk, OP_DEFINE_LOCAL, declareLocal(varStmt->name));
+            }
+            else if (!compilingModule) {
+                emitWithOperand(chunk, OP_DEFINE_GLOBAL, intern(varStmt->name));
             }
             else {
                 if (auto lit = std::dynamic_pointer_cast<LiteralExpr>(varStmt->initializer)) {
                     if (varStmt->access == AccessModifier::PUBLIC) {
-                        currentModulePublicMembers[toLower(varStmt->name)] = lit->value;
+                        currentModulePublicMembers[intern(varStmt->name)] = lit->value;
                     }
-                    vm.environment->define(toLower(varStmt->name), lit->value);
+                    vm.environment->define(intern(varStmt->name), lit->value);
                 }
             }
         }
@@ -3657,65 +6014,80 @@ private:
             int nameConst = addConstantString(chunk, toLower(classStmt->name));
             emitWithOperand(chunk, OP_CLASS, nameConst);
             for (auto method : classStmt->methods) {
-                compileFunction(method);
+                compileFunction(method, true);
                 int fnConst = addConstant(chunk, Value(lastFunction));
                 emitWithOperand(chunk, OP_CONSTANT, fnConst);
-                int methodNameConst = addConstantString(chunk, toLower(method->name));
-                emitWithOperand(chunk, OP_METHOD, methodNameConst);
+                emitWithOperand(chunk, OP_METHOD, intern(method->name));
             }
             if (!classStmt->properties.empty()) {
                 int propConst = addConstant(chunk, Value(classStmt->properties));
                 emitWithOperand(chunk, OP_PROPERTIES, propConst);
             }
-            int classNameConst = addConstantString(chunk, toLower(classStmt->name));
-            emitWithOperand(chunk, OP_DEFINE_GLOBAL, classNameConst);
+            emitWithOperand(chunk, OP_DEFINE_GLOBAL, intern(classStmt->name));
         }
         else if (auto propAssign = std::dynamic_pointer_cast<PropertyAssignmentStmt>(stmt)) {
             compileExpr(propAssign->object, chunk);
             compileExpr(propAssign->value, chunk);
-            int propConst = addConstantString(chunk, toLower(propAssign->property));
-            emitWithOperand(chunk, OP_SET_PROPERTY, propConst);
+            emitPropertyOp(chunk, OP_SET_PROPERTY, intern(propAssign->property));
             emit(chunk, OP_POP);
         }
         else if (auto assignStmt = std::dynamic_pointer_cast<AssignmentStmt>(stmt)) {
-            compileExpr(std::make_shared<VariableExpr>(assignStmt->name), chunk);
+            if (compileAppend(chunk, assignStmt->name, assignStmt->value))
+                return;
+            // As a statement nothing reads the assignment's result, so unlike
+            // AssignmentExpr it doesn't load the old value first.
             compileExpr(assignStmt->value, chunk);
-            int nameConst = addConstantString(chunk, toLower(assignStmt->name));
-            emitWithOperand(chunk, OP_SET_GLOBAL, nameConst);
-            emit(chunk, OP_POP);   // <— pop the old LHS value off the stack
+            emitSetVariable(chunk, assignStmt->name);
         }
         else if (auto setProp = std::dynamic_pointer_cast<SetPropExpr>(stmt)) {
             compileExpr(setProp->object, chunk);
             compileExpr(setProp->value, chunk);
-            int propConst = addConstantString(chunk, toLower(setProp->name));
-            emitWithOperand(chunk, OP_SET_PROPERTY, propConst);
+            emitPropertyOp(chunk, OP_SET_PROPERTY, intern(setProp->name));
             emit(chunk, OP_POP);
         }
         else if (auto ifStmt = std::dynamic_pointer_cast<IfStmt>(stmt)) {
             compileExpr(ifStmt->condition, chunk);
-            int jumpIfFalsePos = chunk.code.size();
-            emitWithOperand(chunk, OP_JUMP_IF_FALSE, 0);
+            int jumpIfFalsePos = emitJump(chunk, OP_JUMP_IF_FALSE);
             for (auto thenStmt : ifStmt->thenBranch)
                 compileStmt(thenStmt, chunk);
-            int jumpPos = chunk.code.size();
-            emitWithOperand(chunk, OP_JUMP, 0);
+            int jumpPos = emitJump(chunk, OP_JUMP);
             int elseStart = chunk.code.size();
-            chunk.code[jumpIfFalsePos + 1] = elseStart;
+            patchJump(chunk, jumpIfFalsePos, elseStart);
             for (auto elseStmt : ifStmt->elseBranch)
                 compileStmt(elseStmt, chunk);
             int endIf = chunk.code.size();
-            chunk.code[jumpPos + 1] = endIf;
+            patchJump(chunk, jumpPos, endIf);
+        }
+        else if (auto selectStmt = std::dynamic_pointer_cast<SelectStmt>(stmt)) {
+            compileSelect(selectStmt, chunk);
+        }
+        else if (auto forStmt = std::dynamic_pointer_cast<ForStmt>(stmt)) {
+            // The counter stays in the loop variable itself; a reference to it,
+            // the limit and the step are evaluated once into three hidden slots.
+            compileStmt(std::make_shared<VarStmt>(forStmt->varName, forStmt->start), chunk);
+            emitVariableRef(chunk, forStmt->varName);
+            compileExpr(forStmt->end, chunk);
+            compileExpr(forStmt->step, chunk);
+            int state = reserveSlots(3);
+            emitWithOperand(chunk, OP_FOR_PREP, state);
+            emitOperand(chunk, forStmt->isDown ? 1 : 0);
+            int exitJumpPos = emitJumpTarget(chunk);
+            int loopStart = chunk.code.size();
+            for (auto bodyStmt : forStmt->body)
+                compileStmt(bodyStmt, chunk);
+            emitWithOperand(chunk, OP_FOR_LOOP, state);
+            emitJumpTarget(chunk, loopStart);
+            patchJump(chunk, exitJumpPos, chunk.code.size());
         }
         else if (auto whileStmt = std::dynamic_pointer_cast<WhileStmt>(stmt)) {
             int loopStart = chunk.code.size();
             compileExpr(whileStmt->condition, chunk);
-            int exitJumpPos = chunk.code.size();
-            emitWithOperand(chunk, OP_JUMP_IF_FALSE, 0);
+            int exitJumpPos = emitJump(chunk, OP_JUMP_IF_FALSE);
             for (auto bodyStmt : whileStmt->body)
                 compileStmt(bodyStmt, chunk);
-            emitWithOperand(chunk, OP_JUMP, loopStart);
+            emitJump(chunk, OP_JUMP, loopStart);
             int loopEnd = chunk.code.size();
-            chunk.code[exitJumpPos + 1] = loopEnd;
+            patchJump(chunk, exitJumpPos, loopEnd);
         }
         else if (auto blockStmt = std::dynamic_pointer_cast<BlockStmt>(stmt)) {
             for (auto s : blockStmt->statements)
@@ -3731,15 +6103,14 @@ private:
             declStmt->apiName,
             declStmt->libraryName
         );
-        vm.environment->define(toLower(declStmt->apiName), Value(apiFunc));
+        vm.environment->define(intern(declStmt->apiName), Value(apiFunc));
         if (!compilingModule) {
-            int fnConst = addConstant(chunk, vm.environment->get(toLower(declStmt->apiName)));
+            int fnConst = addConstant(chunk, vm.environment->get(intern(declStmt->apiName)));
             emitWithOperand(chunk, OP_CONSTANT, fnConst);
-            int nameConst = addConstantString(chunk, toLower(declStmt->apiName));
-            emitWithOperand(chunk, OP_DEFINE_GLOBAL, nameConst);
+            emitWithOperand(chunk, OP_DEFINE_GLOBAL, intern(declStmt->apiName));
         }
         else {
-            currentModulePublicMembers[toLower(declStmt->apiName)] = vm.environment->get(toLower(declStmt->apiName));
+            currentModulePublicMembers[intern(declStmt->apiName)] = vm.environment->get(intern(declStmt->apiName));
         }
     }
 
@@ -3749,8 +6120,12 @@ private:
             emitWithOperand(chunk, OP_CONSTANT, constIndex);
         }
         else if (auto var = std::dynamic_pointer_cast<VariableExpr>(expr)) {
-            int nameConst = addConstantString(chunk, toLower(var->name));
-            emitWithOperand(chunk, OP_GET_GLOBAL, nameConst);
+            int slot = resolveLocal(var->name);
+            if (slot >= 0) {
+                emitWithOperand(chunk, OP_GET_LOCAL, slot);
+            } else {
+                emitWithOperand(chunk, OP_GET_GLOBAL, intern(var->name));
+            }
         }
         else if (auto un = std::dynamic_pointer_cast<UnaryExpr>(expr)) {
             compileExpr(un->right, chunk);
@@ -3766,37 +6141,28 @@ private:
         else if (auto assignExpr = std::dynamic_pointer_cast<AssignmentExpr>(expr)) {
             compileExpr(std::make_shared<VariableExpr>(assignExpr->name), chunk);
             compileExpr(assignExpr->value, chunk);
-            int nameConst = addConstantString(chunk, toLower(assignExpr->name));
-            emitWithOperand(chunk, OP_SET_GLOBAL, nameConst);
+            emitSetVariable(chunk, assignExpr->name);
         }
         else if (auto setProp = std::dynamic_pointer_cast<SetPropExpr>(expr)) {
             compileExpr(setProp->object, chunk);
             compileExpr(setProp->value, chunk);
-            int propConst = addConstantString(chunk, toLower(setProp->name));
-            emitWithOperand(chunk, OP_SET_PROPERTY, propConst);
+            emitPropertyOp(chunk, OP_SET_PROPERTY, intern(setProp->name));
             emit(chunk, OP_POP);   // <— drop the instance that SET_PROPERTY pushed back
         }
         else if (auto bin = std::dynamic_pointer_cast<BinaryExpr>(expr)) {
+            // And/Or skip their right operand when the left one is a Boolean
+            // that already decides the result. Any other left operand (an
+            // Integer, say) still meets the right one in OP_AND/OP_OR.
+            int shortCircuit = -1;
             compileExpr(bin->left, chunk);
+            if (bin->op == BinaryOp::AND)
+                shortCircuit = emitJump(chunk, OP_JUMP_IF_FALSE_KEEP);
+            else if (bin->op == BinaryOp::OR)
+                shortCircuit = emitJump(chunk, OP_JUMP_IF_TRUE_KEEP);
             compileExpr(bin->right, chunk);
-            switch (bin->op) {
-            case BinaryOp::ADD: emit(chunk, OP_ADD); break;
-            case BinaryOp::SUB: emit(chunk, OP_SUB); break;
-            case BinaryOp::MUL: emit(chunk, OP_MUL); break;
-            case BinaryOp::DIV: emit(chunk, OP_DIV); break;
-            case BinaryOp::LT:  emit(chunk, OP_LT); break;
-            case BinaryOp::LE:  emit(chunk, OP_LE); break;
-            case BinaryOp::GT:  emit(chunk, OP_GT); break;
-            case BinaryOp::GE:  emit(chunk, OP_GE); break;
-            case BinaryOp::NE:  emit(chunk, OP_NE); break;
-            case BinaryOp::EQ:  emit(chunk, OP_EQ); break;
-            case BinaryOp::AND: emit(chunk, OP_AND); break;
-            case BinaryOp::OR:  emit(chunk, OP_OR); break;
-            case BinaryOp::XOR: emit(chunk, OP_XOR); break;
-            case BinaryOp::POW: emit(chunk, OP_POW); break;
-            case BinaryOp::MOD: emit(chunk, OP_MOD); break;
-            default: break;
-            }
+            emit(chunk, binaryOpcode(bin->op));
+            if (shortCircuit >= 0)
+                patchJump(chunk, shortCircuit, (int)chunk.code.size());
         }
         else if (auto group = std::dynamic_pointer_cast<GroupingExpr>(expr)) {
             compileExpr(group->expression, chunk);
@@ -3806,11 +6172,16 @@ private:
             // matching arguments as references (OP_GET_REF) instead of values.
             std::vector<Param> calleeParams;
             bool haveSig = false;
+            // A variable that isn't a known function, builtin or class is
+            // most likely an array being indexed.
+            bool maybeArray = false;
 
             if (auto calleeVar = std::dynamic_pointer_cast<VariableExpr>(call->callee)) {
                 std::string calleeName = toLower(calleeVar->name);
                 Value raw;
-                if (vm.environment->tryGetRaw(calleeName, raw)) {
+                maybeArray = resolveLocal(calleeName) >= 0 || !vm.environment->tryGetRaw(calleeName, raw) ||
+                             holds<std::shared_ptr<ObjArray>>(raw);
+                if (!maybeArray) {
                     // Direct function
                     if (holds<std::shared_ptr<ObjFunction>>(raw)) {
                         auto fn = getVal<std::shared_ptr<ObjFunction>>(raw);
@@ -3839,7 +6210,12 @@ private:
                 }
             }
 
-            compileExpr(call->callee, chunk);
+            // obj.Method(args) pushes the receiver instead of a bound method
+            // and compiles to OP_INVOKE. The method is looked up after the
+            // arguments are evaluated, so a nil receiver or missing method is
+            // reported after their side effects have run.
+            auto method = std::dynamic_pointer_cast<GetPropExpr>(call->callee);
+            compileExpr(method ? method->object : call->callee, chunk);
 
             for (size_t i = 0; i < call->arguments.size(); i++) {
                 bool wantByRef = haveSig && (i < calleeParams.size()) && calleeParams[i].byRef;
@@ -3847,8 +6223,7 @@ private:
                 if (wantByRef) {
                     // ByRef arguments must be addressable variables for now.
                     if (auto v = std::dynamic_pointer_cast<VariableExpr>(call->arguments[i])) {
-                        int nameConst = addConstantString(chunk, toLower(v->name));
-                        emitWithOperand(chunk, OP_GET_REF, nameConst);
+                        emitVariableRef(chunk, v->name);
                     } else {
                         runtimeError("ByRef argument must be a variable name.");
                     }
@@ -3857,27 +6232,34 @@ private:
                 }
             }
 
-            emitWithOperand(chunk, OP_CALL, call->arguments.size());
+            if (method)
+                emitInvoke(chunk, intern(method->name), (int)call->arguments.size());
+            else if (maybeArray && call->arguments.size() == 1)
+                emitWithOperand(chunk, OP_INDEX_GET, 1);
+            else if (maybeArray && call->arguments.size() == 2)
+                emitWithOperand(chunk, OP_INDEX_SET, 2);
+            else {
+                lastCall = { &chunk, (int)chunk.code.size() };
+                emitWithOperand(chunk, OP_CALL, call->arguments.size());
+            }
         }
         else if (auto arrLit = std::dynamic_pointer_cast<ArrayLiteralExpr>(expr)) {
             for (auto& elem : arrLit->elements)
                 compileExpr(elem, chunk);
             emitWithOperand(chunk, OP_ARRAY, arrLit->elements.size());
+            emitOperand(chunk, (int)ObjArray::storageFor(arrLit->elementType));
         }
         else if (auto getProp = std::dynamic_pointer_cast<GetPropExpr>(expr)) {
             compileExpr(getProp->object, chunk);
-            int propConst = addConstantString(chunk, toLower(getProp->name));
-            emitWithOperand(chunk, OP_GET_PROPERTY, propConst);
+            emitPropertyOp(chunk, OP_GET_PROPERTY, intern(getProp->name));
         }
         else if (auto newExpr = std::dynamic_pointer_cast<NewExpr>(expr)) {
-            int classConst = addConstantString(chunk, toLower(newExpr->className));
-            emitWithOperand(chunk, OP_GET_GLOBAL, classConst);
+            emitWithOperand(chunk, OP_GET_GLOBAL, intern(newExpr->className));
             emit(chunk, OP_NEW);
         
             /* -------- constructor dispatch -------- */
             emit(chunk, OP_DUP);                       // instance
-            int consName = addConstantString(chunk, "constructor");
-            emitWithOperand(chunk, OP_GET_PROPERTY, consName);   // push constructor (or nil)
+            emitPropertyOp(chunk, OP_GET_PROPERTY, intern("constructor"));   // push constructor (or nil)
         
             /* NEW: push each argument */
             for (auto &arg : newExpr->arguments)
@@ -3891,9 +6273,11 @@ private:
 
     std::shared_ptr<ObjFunction> lastFunction;
 
-    void compileFunction(std::shared_ptr<FunctionStmt> funcStmt) {
+    void compileFunction(std::shared_ptr<FunctionStmt> funcStmt, bool isMethod = false) {
         auto function = std::make_shared<ObjFunction>();
         function->name = funcStmt->name;
+        function->isMethod = isMethod;
+        function->hasReceiver = isMethod || funcStmt->isExtension;
         int req = 0;
         for (auto& p : funcStmt->params)
             if (!p.optional) req++;
@@ -3902,82 +6286,762 @@ private:
         ObjFunction::CodeChunk fnChunk;
         labelTable.clear();
         gotoFixups.clear();
+
+        // Fresh slot map: self or the extension receiver takes slot 0,
+        // then the parameters in declaration order.
+        bool oldCompilingFunction = compilingFunction;
+        auto oldLocalSlots = std::move(localSlots);
+        auto oldByRefLocals = std::move(byRefLocals);
+        int oldLocalCount = localCount;
+        compilingFunction = true;
+        localSlots.clear();
+        byRefLocals.clear();
+        localCount = 0;
+        if (isMethod)
+            declareLocal("self");
+        else if (funcStmt->isExtension)
+            declareLocal(funcStmt->extendedParam);
+        for (auto& p : funcStmt->params) {
+            declareLocal(p.name);
+            if (p.byRef)
+                byRefLocals.insert(toLower(p.name));
+        }
+
         for (auto stmt : funcStmt->body){
             compileStmt(stmt, fnChunk);
         }
+        function->localCount = localCount;
+        compilingFunction = oldCompilingFunction;
+        localSlots = std::move(oldLocalSlots);
+        byRefLocals = std::move(oldByRefLocals);
+        localCount = oldLocalCount;
         for (auto& f : gotoFixups) {
             if (labelTable.find(f.label) == labelTable.end())
                 runtimeError("Undefined label: " + f.label + " in function " + function->name);
-            fnChunk.code[f.patchIndex] = labelTable[f.label];
+            patchJump(fnChunk, f.patchIndex, labelTable[f.label]);
         }
         
         emit(fnChunk, OP_NIL);
         emit(fnChunk, OP_RETURN);
-        function->chunk = fnChunk;
+        if (OPTIMIZE_LEVEL > 0)
+            optimizeChunk(fnChunk);
+        fnChunk.constantIndex.clear();
+        function->chunk = std::move(fnChunk);
         lastFunction = function;
-        debugLog("Compiler: Compiled function: " + function->name + " with required arity " + std::to_string(function->arity));
+        DEBUG_TRACE(TRACE_COMPILER, "Compiler: Compiled function: " + function->name + " with required arity " + std::to_string(function->arity));
     }
 };
 
-// choose the first overload whose required/total arity matches |args|
-static Value resolveOverload(const Value &candidate,
-                             const std::vector<Value> &args)
+// choose the first overload whose required/total arity matches argc
+static std::shared_ptr<ObjFunction> resolveOverload(
+    const std::vector<std::shared_ptr<ObjFunction>>& overloads, int argc)
 {
-    if (!holds<std::vector<std::shared_ptr<ObjFunction>>>(candidate))
-        return candidate; // already a single fn
-
-    const auto &overloads =
-        getVal<std::vector<std::shared_ptr<ObjFunction>>>(candidate);
-
     for (auto &f : overloads)
     {
         int total = f->params.size();
         int required = f->arity;
-        if ((int)args.size() >= required && (int)args.size() <= total)
-            return Value(f);
+        if (argc >= required && argc <= total)
+            return f;
     }
-    runtimeError("VM: no matching overload for call with " + std::to_string(args.size()) + " argument(s).");
-    return Value(std::monostate{});
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: OP_TAIL_CALL frees the caller's slots before the callee runs, so it
+// can't when an argument is a reference (ByRef), which may point into them.
+// ----------------------------------------------------------------------------
+static bool tailCallArgumentsMovable(const Value* args, int argc)
+{
+    for (int i = 0; i < argc; i++)
+        if (holds<std::shared_ptr<ObjRef>>(args[i]))
+            return false;
+    return true;
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: if `callee` is a scripted function, an overload set or a bound
+// scripted method, pick the ObjFunction to run for `argc` arguments and its
+// receiver. Returns false for anything else (builtins, arrays, plugins...).
+// ----------------------------------------------------------------------------
+static bool resolveScriptedCall(const Value& callee, int argc,
+                                std::shared_ptr<ObjFunction>& fn, Value& receiver)
+{
+    if (holds<std::shared_ptr<ObjFunction>>(callee)) {
+        fn = valueRef<std::shared_ptr<ObjFunction>>(callee);
+        return true;
+    }
+    if (holds<std::vector<std::shared_ptr<ObjFunction>>>(callee)) {
+        fn = resolveOverload(valueRef<std::vector<std::shared_ptr<ObjFunction>>>(callee), argc);
+        if (!fn)
+            runtimeError("VM: No matching overload found for function call with " +
+                         std::to_string(argc) + " arguments.");
+        return true;
+    }
+    if (!holds<std::shared_ptr<ObjBoundMethod>>(callee))
+        return false;
+
+    const auto& bound = valueRef<std::shared_ptr<ObjBoundMethod>>(callee);
+    if (!holds<std::shared_ptr<ObjInstance>>(bound->receiver))
+        return false;
+    const auto& instance = valueRef<std::shared_ptr<ObjInstance>>(bound->receiver);
+    auto it = instance->klass->methods.find(bound->name);
+    if (it == instance->klass->methods.end())
+        return false;
+
+    if (holds<std::shared_ptr<ObjFunction>>(it->second)) {
+        fn = valueRef<std::shared_ptr<ObjFunction>>(it->second);
+    }
+    else if (holds<std::vector<std::shared_ptr<ObjFunction>>>(it->second)) {
+        fn = resolveOverload(valueRef<std::vector<std::shared_ptr<ObjFunction>>>(it->second), argc);
+        if (!fn)
+            runtimeError("VM: No matching method found for " + bound->name);
+    }
+    else {
+        return false;
+    }
+
+    // Scripted methods on plugin classes see the plugin handle as self.
+    if (instance->klass->isPlugin)
+        receiver = Value(static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance)));
+    else
+        receiver = bound->receiver;
+    return true;
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: call anything that does not need a new VM frame – builtins, bound
+// builtin/plugin/extension methods, array get/set and the string-named
+// builtins. Scripted calls are dispatched by the caller first.
+// ----------------------------------------------------------------------------
+static Value callValue(VM& vm, const Value& callee, ArgSpan args)
+{
+    int argCount = (int)args.size();
+
+    // ---------------------------  BUILTIN  -----------------------------------
+    if (holds<BuiltinFn>(callee)) {
+        return valueRef<BuiltinFn>(callee)(args);
+    }
+
+    // ----------------------  BOUND METHOD CALL  -------------------------------
+    else if (holds<std::shared_ptr<ObjBoundMethod>>(callee)) {
+        auto bound = getVal<std::shared_ptr<ObjBoundMethod>>(callee);
+
+        // NEW: string extension
+        if (holds<std::string>(bound->receiver)) {
+            // look up the extension
+            auto &exts = vm.extensionMethods["string"];
+            auto it   = exts.find(bound->name);
+            if (it == exts.end())
+                runtimeError("No string extension: " + symbolName(bound->name));
+            // invoke it with the receiver prepended
+            std::vector<Value> newArgs(args.begin(), args.end());
+            newArgs.insert(newArgs.begin(), bound->receiver);
+            return getVal<BuiltinFn>(it->second)(newArgs);
+        }
+        /* ── NEW: Integer / Double / Boolean extensions ────────────────── */
+        else if (holds<int>(bound->receiver) ||
+                holds<double>(bound->receiver) ||
+                holds<bool>(bound->receiver))
+        {
+            std::string typeKey =
+                holds<int>(bound->receiver)    ? "integer" :
+                holds<double>(bound->receiver) ? "double"  : "boolean";
+
+            auto &exts = vm.extensionMethods[typeKey];
+            auto it    = exts.find(bound->name);
+            if (it == exts.end())
+                runtimeError("No " + typeKey + " extension: " + symbolName(bound->name));
+
+            std::vector<Value> newArgs(args.begin(), args.end());   // the call’s arguments
+            newArgs.insert(newArgs.begin(), bound->receiver);   // prepend receiver
+
+            return getVal<BuiltinFn>(it->second)(newArgs);
+        }
+
+        // Instance methods
+        if (holds<std::shared_ptr<ObjInstance>>(bound->receiver)) {
+            auto instance = getVal<std::shared_ptr<ObjInstance>>(bound->receiver);
+            auto mit = instance->klass->methods.find(bound->name);
+            Value methodVal = (mit != instance->klass->methods.end()) ? mit->second : Value(std::monostate{});
+
+            // If it's a BuiltinFn on a plugin class, prepend handle
+            if (holds<BuiltinFn>(methodVal) && instance->klass->isPlugin) {
+                BuiltinFn fn = getVal<BuiltinFn>(methodVal);
+                int handle = static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance));
+                std::vector<Value> newArgs;
+                newArgs.push_back(Value(handle));
+                newArgs.insert(newArgs.end(), args.begin(), args.end());
+                return fn(newArgs);
+            }
+            // If it's a simple BuiltinFn
+            else if (holds<BuiltinFn>(methodVal)) {
+                BuiltinFn fn = getVal<BuiltinFn>(methodVal);
+                return fn(args);
+            }
+            // Scripted methods were dispatched above; nothing else is callable
+            else {
+                runtimeError("VM: No matching method found for " + symbolName(bound->name));
+            }
+        }
+        // Array methods
+        else if (holds<std::shared_ptr<ObjArray>>(bound->receiver)) {
+            auto array = getVal<std::shared_ptr<ObjArray>>(bound->receiver);
+            return callArrayMethod(array, bound->name, args);
+        }
+        else {
+            runtimeError("VM: Bound method receiver is of unsupported type.");
+        }
+    }
+
+    // -----------------------  ARRAY CALL  -----------------------------------
+    else if (holds<std::shared_ptr<ObjArray>>(callee)) {
+        auto array = getVal<std::shared_ptr<ObjArray>>(callee);
+
+        /* ---------------- get item ---------------- */
+        if (argCount == 1) {
+            Value idx = args[0];
+            if (!holds<int>(idx))
+                runtimeError("VM: Array index must be an Integer.");
+            int i = getVal<int>(idx);
+            if (i < 0 || i >= (int)array->size())
+                runtimeError("VM: Array index out of bounds.");
+            return array->get(i);
+        }
+
+        /* ---------------- set item ---------------- */
+        else if (argCount == 2) {
+            Value idx = args[0];
+            if (!holds<int>(idx))
+                runtimeError("VM: Array index must be an Integer.");
+            int i = getVal<int>(idx);
+            if (i < 0)
+                runtimeError("VM: Array index must be ≥ 0.");
+
+            /* auto-grow, like Xojo */
+            if (i == (int)array->size())
+                array->append(args[1]);
+            else {
+                array->growTo(i + 1);
+                array->set(i, args[1]);        // assign
+            }
+            return args[1];       // return the new value
+        }
+
+        /* anything else is an error */
+        else {
+            runtimeError("VM: Array call expects 1 (get) or 2 (set) arguments.");
+        }
+    }
+
+    // -----------------  STRING-BASED BUILT-INS  ------------------------------
+    else if (holds<std::string>(callee)) {
+        std::string funcName = toLower(getVal<std::string>(callee));
+        if (funcName == "print") {
+            if (args.empty()) runtimeError("VM: print expects an argument.");
+            std::cout << valueToString(args[0]) << std::endl;
+            return args[0];
+        }
+        else if (funcName == "str") {
+            if (args.empty()) runtimeError("VM: str expects an argument.");
+            return Value(valueToString(args[0]));
+        }
+        else if (funcName == "ticks") {
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - startTime).count();
+            return (int)(seconds * 60);
+        }
+        else if (funcName == "microseconds") {
+            auto now = std::chrono::steady_clock::now();
+            double us = std::chrono::duration<double, std::micro>(now - startTime).count();
+            return us;
+        }
+        else if (funcName == "val") {
+            if (args.size() != 1) runtimeError("VM: val expects exactly one argument.");
+            if (!holds<std::string>(args[0])) runtimeError("VM: val expects a string argument.");
+            double d = std::stod(getVal<std::string>(args[0]));
+            return d;
+        }
+        else {
+            runtimeError("VM: Unknown built-in function: " + funcName);
+        }
+    }
+
+    // -----------------------  INVALID CALL  ----------------------------------
+    else {
+        runtimeError("VM: Can only call functions, methods, arrays, or built-in functions.");
+    }
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: OP_GET_PROPERTY's slow path – resolve `name` on any receiver
+// (enums, instances, arrays, modules, classes, extension methods...).
+// Instance lookups are recorded in the site's inline cache.
+// ----------------------------------------------------------------------------
+static Value getProperty(VM& vm, const Value& receiver, Symbol name,
+                         PropertyCache& cache)
+{
+    const std::string& lowerName = symbolName(name);
+
+    // --------------------------------------------------------
+    // 0) Enums – EnumName.Member
+    // --------------------------------------------------------
+    {
+        Value enumOut;
+        if (tryGetEnumMember(receiver, lowerName, enumOut)) {
+            return enumOut;
+        }
+    }
+
+    // --------------------------------------------------------
+    // 1) Instance fields / methods (including plugin classes)
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjInstance>>(receiver)) {
+        auto inst  = getVal<std::shared_ptr<ObjInstance>>(receiver);
+        auto klass = inst ? inst->klass : nullptr;
+
+        // Instance fields first
+        if (inst) {
+            if (Value* cell = inst->findField(name)) {
+                int slot = klass && klass->shape ? klass->shape->slotOf(name) : -1;
+                if (slot >= 0)
+                    cache.record(klass, PropertyCache::FIELD, slot);
+                return *cell;
+            }
+        }
+
+        // Plugin-backed properties (getter)
+        if (inst && klass && klass->isPlugin) {
+            auto pit = klass->pluginProperties.find(name);
+            if (pit != klass->pluginProperties.end()) {
+                BuiltinFn getter = pit->second.first;
+                if (!getter)
+                    runtimeError("Property '" + lowerName + "' does not have a getter.");
+                cache.record(klass, PropertyCache::PLUGIN_GETTER, -1, &pit->second.first);
+
+                int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
+                Value callArgs[] = { Value(handle) };
+                return getter(ArgSpan(callArgs, 1));
+            }
+        }
+
+        // Class methods
+        if (inst && klass) {
+            auto mit = klass->methods.find(name);
+            if (mit != klass->methods.end()) {
+                Value methVal = mit->second;
+
+                // Plugin methods – bind the handle as the first arg.
+                if (klass->isPlugin && holds<BuiltinFn>(methVal)) {
+                    cache.record(klass, PropertyCache::PLUGIN_METHOD, -1, nullptr, methVal);
+                    BuiltinFn raw = getVal<BuiltinFn>(methVal);
+                    int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
+                    BuiltinFn bound = [raw, handle](ArgSpan args) -> Value {
+                        std::vector<Value> full;
+                        full.reserve(args.size() + 1);
+                        full.emplace_back(handle);
+                        full.insert(full.end(), args.begin(), args.end());
+                        return raw(full);
+                    };
+                    return Value(bound);
+                }
+
+                // Scripted method – return bound-method object
+                cache.record(klass, PropertyCache::METHOD, -1, nullptr, methVal);
+                auto bm = std::make_shared<ObjBoundMethod>();
+                bm->receiver = receiver;
+                bm->name     = name;
+                return Value(bm);
+            }
+        }
+
+        // If we fall through, we’ll still give extension methods a chance
+        // and then the legacy "constructor" / "tostring" / plugin fallback below.
+    }
+
+    // --------------------------------------------------------
+    // 2) Arrays – expose methods (Add, Count, Join, etc.)
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjArray>>(receiver)) {
+        auto arr = getVal<std::shared_ptr<ObjArray>>(receiver);
+
+        // Return a callable that dispatches to callArrayMethod(...)
+        BuiltinFn bound = [arr, name](ArgSpan args) -> Value {
+            return callArrayMethod(arr, name, args);
+        };
+        return Value(bound);
+    }
+
+    // --------------------------------------------------------
+    // 2.5) Dictionaries – same, via callDictionaryMethod(...); New still
+    //      probes .constructor, which falls through to the sentinel below.
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjDictionary>>(receiver) && lowerName != "constructor") {
+        auto dict = getVal<std::shared_ptr<ObjDictionary>>(receiver);
+        BuiltinFn bound = [dict, name](ArgSpan args) -> Value {
+            return callDictionaryMethod(dict, name, args);
+        };
+        return Value(bound);
+    }
+
+    // --------------------------------------------------------
+    // 3) Modules – module.member
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjModule>>(receiver)) {
+        auto mod = getVal<std::shared_ptr<ObjModule>>(receiver);
+        auto it  = mod->publicMembers.find(name);
+        if (it != mod->publicMembers.end()) {
+            return it->second;
+        }
+        // fall through for extension methods / constructor / tostring / plugin fallback
+    }
+
+    // --------------------------------------------------------
+    // 4) Classes – static methods
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjClass>>(receiver)) {
+        auto cls = getVal<std::shared_ptr<ObjClass>>(receiver);
+        auto mit = cls->methods.find(name);
+        if (mit != cls->methods.end()) {
+            return mit->second;
+        }
+        // fall through for extension methods / constructor / tostring / plugin fallback
+    }
+
+    // --------------------------------------------------------
+    // 5) EXTENSION METHODS on primitives (Integer, Double, String, …)
+    // --------------------------------------------------------
+    {
+        Value ext = bindExtensionMethod(vm, receiver, name);
+        if (!holds<std::monostate>(ext)) {
+            // ext is already a callable (BuiltinFn) bound to this receiver.
+            return ext;
+        }
+    }
+
+    // --------------------------------------------------------
+    // 5.5) Legacy ".constructor" sentinel
+    //
+    // Older bytecode and the plugin class machinery sometimes probe
+    // `.constructor` just to see if anything is there. Historically this
+    // did NOT throw – it pushed a "no ctor" sentinel instead.
+    // --------------------------------------------------------
+    if (lowerName == "constructor") {
+        return Value(std::monostate{}); // "no ctor" sentinel
+    }
+
+    // --------------------------------------------------------
+    // 6) Built-in .tostring on core types (after extensions / ctor)
+    //
+    // Mirrors the old behavior:
+    //   - String: returns the raw string (no extra quoting)
+    //   - Int/Double/Arrays/Instances/etc: valueToString(receiver)
+    // --------------------------------------------------------
+    if (lowerName == "tostring") {
+        if (holds<std::string>(receiver)) {
+            // Old semantics: for string, just return the string itself.
+            const std::string& s = getVal<std::string>(receiver);
+            return Value(s);
+        }
+        return Value(valueToString(receiver));
+    }
+
+    // --------------------------------------------------------
+    // 7) Optional: built-in string helpers AFTER extension / tostring
+    // --------------------------------------------------------
+    if (holds<std::string>(receiver)) {
+        const std::string& s = getVal<std::string>(receiver);
+
+        if (lowerName == "length") {
+            return (int)s.size();
+        }
+        // Add other built-in string properties/methods here if needed.
+    }
+
+    // --------------------------------------------------------
+    // 8) FINAL PLUGIN INSTANCE FALLBACK (for things like ".handle")
+    //
+    // This restores the old behavior:
+    //   unknown plugin property ⇒ "ClassName:handle:propName"
+    // so that ClassObject.handle and similar patterns work.
+    // --------------------------------------------------------
+    if (holds<std::shared_ptr<ObjInstance>>(receiver)) {
+        auto inst  = getVal<std::shared_ptr<ObjInstance>>(receiver);
+        auto klass = inst ? inst->klass : nullptr;
+        if (inst && klass && klass->isPlugin) {
+            int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
+            std::string target = klass->name + ":" +
+                                std::to_string(handle) + ":" +
+                                lowerName;
+            return Value(target);
+        }
+    }
+
+    // If nothing matched, this really is an error.
+    runtimeError("Undefined property or method '" + lowerName + "'");
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: OP_SET_PROPERTY's field store. Declared fields are cached by slot;
+// undeclared names become dictionary fields on this instance only.
+// ----------------------------------------------------------------------------
+static void storeField(PropertyCache& cache, ObjInstance& instance,
+                       Symbol name, const Value& value)
+{
+    int slot = instance.klass->shape ? instance.klass->shape->slotOf(name) : -1;
+    if (slot >= 0 && slot < (int)instance.slots.size()) {
+        cache.record(instance.klass, PropertyCache::FIELD, slot);
+        instance.slots[slot] = value;
+    } else {
+        instance.fieldRef(name) = value;
+    }
+}
+
+// ----------------------------------------------------------------------------  
+// Helper: implicit-self field lookup. Inside a class method, names that are
+// not locals resolve to fields of self before globals.
+// ----------------------------------------------------------------------------
+static Value* selfFieldCell(VM& vm, const CallFrame& frame, Symbol name)
+{
+    if (!frame.function || !frame.function->isMethod)
+        return nullptr;
+    const Value& self = vm.slots[frame.slotBase];
+    if (!holds<std::shared_ptr<ObjInstance>>(self))
+        return nullptr;
+    return valueRef<std::shared_ptr<ObjInstance>>(self)->findField(name);
+}
+
+// ----------------------------------------------------------------------------
+// Addition as OP_ADD defines it: int, double (with int promotion) or string
+// concatenation.
+// ----------------------------------------------------------------------------
+static Value addValues(const Value& a, const Value& b)
+{
+    if (holds<int>(a) && holds<int>(b))
+        return getVal<int>(a) + getVal<int>(b);
+    if (holds<double>(a) || holds<double>(b)) {
+        double ad = holds<double>(a) ? getVal<double>(a) : static_cast<double>(getVal<int>(a));
+        double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
+        return ad + bd;
+    }
+    if (holds<std::string>(a) && holds<std::string>(b))
+        return getVal<std::string>(a) + getVal<std::string>(b);
+    runtimeError("VM: Operands must be numbers or strings for addition.");
+}
+
+// target = target + pieces[0] + ... + pieces[count-1]. When everything is a
+// string and target owns its buffer (s = s + x), the pieces are appended in
+// place and the buffer grows geometrically, so a loop building up one
+// variable costs amortized O(1) per append. A shared target (a plain a + b)
+// is left alone and the result is built at exactly its final size.
+static void appendValues(Value& target, const Value* pieces, int count)
+{
+    if (holds<std::string>(target)) {
+        bool allStrings = true;
+        size_t extra = 0;
+        for (int i = 0; i < count && allStrings; ++i) {
+            allStrings = holds<std::string>(pieces[i]);
+            if (allStrings) extra += valueRef<std::string>(pieces[i]).size();
+        }
+        if (allStrings && target.shared()) {
+            const std::string& left = valueRef<std::string>(target);
+            std::string result;
+            result.reserve(left.size() + extra);
+            result += left;
+            for (int i = 0; i < count; ++i)
+                result += valueRef<std::string>(pieces[i]);
+            target = Value(std::move(result));
+            return;
+        }
+        if (allStrings) {
+            std::string& buf = target.mut<std::string>();
+            if (buf.capacity() < buf.size() + extra)
+                buf.reserve(std::max(buf.size() + extra, buf.capacity() * 2));
+            for (int i = 0; i < count; ++i)
+                buf += valueRef<std::string>(pieces[i]);
+            return;
+        }
+    }
+    Value acc = target;
+    for (int i = 0; i < count; ++i)
+        acc = addValues(acc, pieces[i]);
+    target = std::move(acc);
+}
+
+// ----------------------------------------------------------------------------
+// Quickening. After a generic arithmetic/comparison op succeeds, the VM
+// rewrites that instruction into the form specialized for the operand types
+// it just saw (pass -1 where no specialization exists). The specialized form
+// checks its guard and, when the types change, writes the generic opcode
+// back and re-executes it.
+// ----------------------------------------------------------------------------
+static inline void quicken(uint8_t* code, int at, const Value& a, const Value& b,
+                           int intOp, int doubleOp, int stringOp = -1)
+{
+    if (a.index() != b.index())
+        return;
+    if (intOp >= 0 && holds<int>(a))
+        code[at] = (uint8_t)intOp;
+    else if (doubleOp >= 0 && holds<double>(a))
+        code[at] = (uint8_t)doubleOp;
+    else if (stringOp >= 0 && holds<std::string>(a))
+        code[at] = (uint8_t)stringOp;
+}
+
+// Handler body for a quickened binary op on two operands of type T; `a` and
+// `b` name the operands inside expr. Deoptimizes to `generic` on a miss.
+#define VM_QUICK_BINARY(generic, T, expr)                                   \
+    {                                                                       \
+        Value& lhs = vm.stack[vm.stack.size() - 2];                         \
+        const Value& rhs = vm.stack.back();                                 \
+        if (holds<T>(lhs) && holds<T>(rhs)) {                               \
+            const T& a = valueRef<T>(lhs);                                  \
+            const T& b = valueRef<T>(rhs);                                  \
+            lhs = Value(expr);                                              \
+            vm.stack.pop_back();                                            \
+            VM_NEXT();                                                      \
+        }                                                                   \
+        code[currentIp] = generic;                                          \
+        ip = currentIp;                                                     \
+        VM_NEXT();                                                          \
+    }
+
+// ----------------------------------------------------------------------------
+// For/Next helpers. The step's sign gives the direction: a loop keeps going
+// while counter <= limit (step >= 0) or counter >= limit (step < 0).
+// ----------------------------------------------------------------------------
+static inline bool isNumber(const Value& v) {
+    return holds<int>(v) || holds<double>(v);
+}
+
+static inline double numberAsDouble(const Value& v) {
+    return holds<double>(v) ? getVal<double>(v) : static_cast<double>(getVal<int>(v));
+}
+
+static bool forLoopContinues(const Value& counter, const Value& limit, const Value& step) {
+    if (!isNumber(counter))
+        runtimeError("VM: For loop counter must be a number.");
+    if (holds<int>(counter) && holds<int>(limit) && holds<int>(step))
+        return getVal<int>(step) >= 0 ? getVal<int>(counter) <= getVal<int>(limit)
+                                      : getVal<int>(counter) >= getVal<int>(limit);
+    double c = numberAsDouble(counter), l = numberAsDouble(limit);
+    return numberAsDouble(step) >= 0 ? c <= l : c >= l;
+}
+
+// TRACE_STACK output after each instruction; callers check traceEnabled().
+static void traceStack(const VM& vm) {
+    std::string s = "[";
+    for (auto& v : vm.stack)
+        s += valueToString(v) + ", ";
+    s += "]";
+    debugLog("VM: Stack after execution: " + s);
+}
+
+// ----------------------------------------------------------------------------
+// Instruction dispatch. GCC/Clang builds jump through a table of label
+// addresses (computed goto): every handler ends in VM_NEXT(), which fetches
+// the next opcode and jumps straight to its handler, so each handler has its
+// own indirect branch. Other compilers, or a build with
+// -DCROSSBASIC_SWITCH_DISPATCH, use the portable switch, where VM_NEXT()
+// just leaves the switch for the next turn of the loop.
+// ----------------------------------------------------------------------------
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(CROSSBASIC_SWITCH_DISPATCH)
+#define CROSSBASIC_COMPUTED_GOTO 1
+#define VM_CASE(op) case op: L_##op:
+#define VM_NEXT()                                                           \
+    {                                                                       \
+        if (traceEnabled(TRACE_VM | TRACE_STACK))                           \
+            traceStep(vm, ip, code[ip]);                                    \
+        currentIp = ip;                                                     \
+        instruction = code[ip++];                                           \
+        goto *dispatchTable[instruction];                                   \
+    }
+
+// Trace output between two instructions in the computed-goto loop, kept out
+// of line so the copy of VM_NEXT() in every handler stays small.
+static void traceStep(const VM& vm, int nextIp, int nextInstruction) {
+    if (traceEnabled(TRACE_STACK))
+        traceStack(vm);
+    DEBUG_TRACE(TRACE_VM, "VM: IP " + std::to_string(nextIp) + ": Executing " + opcodeToString(nextInstruction));
 }
+#else
+#define CROSSBASIC_COMPUTED_GOTO 0
+#define VM_CASE(op) case op:
+#define VM_NEXT() break
+#endif
 
 // ============================================================================  
 // Virtual Machine Execution
+// Runs until the frame that was on top at entry returns. Scripted calls push
+// a frame and continue in this loop; host code re-enters through runVM() and
+// runFunction().
 // ============================================================================
-Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
+Value runFrames(VM& vm) {
+    const size_t entryDepth = vm.frames.size() - 1;
+    CallFrame* frame = nullptr;
+    ObjFunction::CodeChunk* chunk = nullptr;
+    uint8_t* code = nullptr;
+    Value* locals = nullptr;
     int ip = 0;
-    while (ip < chunk.code.size()) {
-
-        // Process any pending callbacks from plugin events for any yielded threads.
-        processPendingCallbacks();
+    auto loadFrame = [&]() {
+        frame  = &vm.frames.back();
+        chunk  = frame->chunk;
+        code   = chunk->code.data();
+        locals = vm.slots.data() + frame->slotBase;
+        ip     = frame->ip;
+    };
+    loadFrame();
+
+#if CROSSBASIC_COMPUTED_GOTO
+    // One entry per opcode, in enum OpCode order.
+    static void* const dispatchTable[] = {
+        &&L_OP_CONSTANT, &&L_OP_ADD, &&L_OP_SUB, &&L_OP_MUL, &&L_OP_DIV,
+        &&L_OP_NEGATE, &&L_OP_POW, &&L_OP_MOD, &&L_OP_LT, &&L_OP_LE,
+        &&L_OP_GT, &&L_OP_GE, &&L_OP_NE, &&L_OP_EQ, &&L_OP_AND,
+        &&L_OP_OR, &&L_OP_XOR, &&L_OP_PRINT, &&L_OP_POP, &&L_OP_DEFINE_GLOBAL,
+        &&L_OP_GET_GLOBAL, &&L_OP_GET_REF, &&L_OP_SET_GLOBAL, &&L_OP_NEW, &&L_OP_CALL,
+        &&L_OP_OPTIONAL_CALL, &&L_OP_RETURN, &&L_OP_NIL, &&L_OP_JUMP_IF_FALSE, &&L_OP_JUMP,
+        &&L_OP_CLASS, &&L_OP_METHOD, &&L_OP_ARRAY, &&L_OP_GET_PROPERTY, &&L_OP_SET_PROPERTY,
+        &&L_OP_PROPERTIES, &&L_OP_DUP, &&L_OP_CONSTRUCTOR_END, &&L_OP_NOT, &&L_OP_GET_LOCAL,
+        &&L_OP_SET_LOCAL, &&L_OP_DEFINE_LOCAL, &&L_OP_GET_LOCAL_REF, &&L_OP_FOR_PREP, &&L_OP_FOR_LOOP,
+        &&L_OP_INVOKE, &&L_OP_APPEND_LOCAL, &&L_OP_APPEND_GLOBAL, &&L_OP_INDEX_GET, &&L_OP_INDEX_SET,
+        &&L_OP_SWITCH, &&L_OP_JUMP_IF_FALSE_KEEP, &&L_OP_JUMP_IF_TRUE_KEEP, &&L_OP_SET_LOCAL_KEEP,
+        &&L_OP_SET_GLOBAL_KEEP, &&L_OP_TAIL_CALL,
+        &&L_OP_ADD_II, &&L_OP_ADD_DD, &&L_OP_CONCAT_SS, &&L_OP_SUB_II, &&L_OP_SUB_DD,
+        &&L_OP_MUL_II, &&L_OP_MUL_DD, &&L_OP_MOD_II, &&L_OP_LT_II, &&L_OP_LT_DD,
+        &&L_OP_LE_II, &&L_OP_LE_DD, &&L_OP_GT_II, &&L_OP_GT_DD, &&L_OP_GE_II,
+        &&L_OP_GE_DD, &&L_OP_EQ_II, &&L_OP_NE_II
+    };
+    static_assert(sizeof(dispatchTable) / sizeof(dispatchTable[0]) == OP_COUNT,
+                  "dispatchTable must list every opcode");
+#endif
 
-        int currentIp = ip;
-        int instruction = chunk.code[ip++];
+    // Chunks always end in OP_RETURN, so ip never runs past the code.
+    int currentIp = 0;
+    int instruction = 0;
+    for (;;) {
+        currentIp = ip;
+        instruction = code[ip++];
 
-        debugLog("VM: IP " + std::to_string(currentIp) + ": Executing " + opcodeToString(instruction));
+        DEBUG_TRACE(TRACE_VM, "VM: IP " + std::to_string(currentIp) + ": Executing " + opcodeToString(instruction));
 
+#if CROSSBASIC_COMPUTED_GOTO
+        goto *dispatchTable[instruction];
+#endif
         switch (instruction) {
-        case OP_CONSTANT: {
-            int index = chunk.code[ip++];
-            Value constant = chunk.constants[index];
+        VM_CASE(OP_CONSTANT) {
+            int index = readOperand(code, ip);
+            Value constant = chunk->constants[index];
             vm.stack.push_back(constant);
-            debugLog("VM: Loaded constant: " + valueToString(constant));
-            break;
+            DEBUG_TRACE(TRACE_VM, "VM: Loaded constant: " + valueToString(constant));
+            VM_NEXT();
         }
-        case OP_ADD: {
+        VM_CASE(OP_ADD) {
             Value b = pop(vm), a = pop(vm);
-            if (holds<int>(a) && holds<int>(b))
-                vm.stack.push_back(getVal<int>(a) + getVal<int>(b));
-            else if (holds<double>(a) || holds<double>(b)) {
-                double ad = holds<double>(a) ? getVal<double>(a) : static_cast<double>(getVal<int>(a));
-                double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
-                vm.stack.push_back(ad + bd);
-            }
-            else if (holds<std::string>(a) && holds<std::string>(b))
-                vm.stack.push_back(getVal<std::string>(a) + getVal<std::string>(b));
-            else runtimeError("VM: Operands must be numbers or strings for addition.");
-            break;
+            vm.stack.push_back(addValues(a, b));
+            quicken(code, currentIp, a, b, OP_ADD_II, OP_ADD_DD, OP_CONCAT_SS);
+            VM_NEXT();
         }
-        case OP_SUB: {
+        VM_CASE(OP_SUB) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -3992,9 +7056,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad - bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_SUB_II, OP_SUB_DD);
+    VM_NEXT();
 }
-        case OP_MUL: {
+        VM_CASE(OP_MUL) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4009,9 +7074,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad * bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_MUL_II, OP_MUL_DD);
+    VM_NEXT();
 }
-        case OP_DIV: {
+        VM_CASE(OP_DIV) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4022,18 +7088,18 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
     double ad = holds<double>(a) ? getVal<double>(a) : static_cast<double>(getVal<int>(a));
     double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
     vm.stack.push_back(ad / bd);
-    break;
+    VM_NEXT();
 }
-        case OP_NEGATE: {
+        VM_CASE(OP_NEGATE) {
             Value v = pop(vm);
             if (holds<int>(v))
                 vm.stack.push_back(-getVal<int>(v));
             else if (holds<double>(v))
                 vm.stack.push_back(-getVal<double>(v));
             else runtimeError("VM: Operand must be a number for negation.");
-            break;
+            VM_NEXT();
         }
-        case OP_POW: {
+        VM_CASE(OP_POW) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4044,9 +7110,9 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
     double ad = holds<double>(a) ? getVal<double>(a) : static_cast<double>(getVal<int>(a));
     double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
     vm.stack.push_back(std::pow(ad, bd));
-    break;
+    VM_NEXT();
 }
-        case OP_MOD: {
+        VM_CASE(OP_MOD) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4061,9 +7127,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(std::fmod(ad, bd));
     }
-    break;
+    quicken(code, currentIp, a, b, OP_MOD_II, -1);
+    VM_NEXT();
 }
-        case OP_LT: {
+        VM_CASE(OP_LT) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4078,9 +7145,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad < bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_LT_II, OP_LT_DD);
+    VM_NEXT();
 }
-        case OP_LE: {
+        VM_CASE(OP_LE) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4095,9 +7163,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad <= bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_LE_II, OP_LE_DD);
+    VM_NEXT();
 }
-        case OP_GT: {
+        VM_CASE(OP_GT) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4112,9 +7181,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad > bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_GT_II, OP_GT_DD);
+    VM_NEXT();
 }
-        case OP_GE: {
+        VM_CASE(OP_GE) {
     Value b = pop(vm), a = pop(vm);
 
     const bool aNum = holds<int>(a) || holds<double>(a);
@@ -4129,9 +7199,10 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
         double bd = holds<double>(b) ? getVal<double>(b) : static_cast<double>(getVal<int>(b));
         vm.stack.push_back(ad >= bd);
     }
-    break;
+    quicken(code, currentIp, a, b, OP_GE_II, OP_GE_DD);
+    VM_NEXT();
 }
-        case OP_EQ: {
+        VM_CASE(OP_EQ) {
             Value b = pop(vm), a = pop(vm);
         
             /* ──────────  numbers  ────────── */
@@ -4163,10 +7234,11 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
             /* ──────────  fallback  ────────── */
             else
                 vm.stack.push_back(false);
-            break;
+            quicken(code, currentIp, a, b, OP_EQ_II, -1);
+            VM_NEXT();
         }
         
-        case OP_NE: {
+        VM_CASE(OP_NE) {
             Value b = pop(vm), a = pop(vm);
         
             if (holds<int>(a) && holds<int>(b))
@@ -4192,25 +7264,26 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
                 vm.stack.push_back(getVal<void*>(a) != getVal<void*>(b));
             else
                 runtimeError("VM: Operands are not comparable for '<>'.");
-            break;
+            quicken(code, currentIp, a, b, OP_NE_II, -1);
+            VM_NEXT();
         }
         
-        case OP_AND: {
+        VM_CASE(OP_AND) {
             Value b = pop(vm), a = pop(vm);
             bool ab = (holds<bool>(a)) ? getVal<bool>(a) : (holds<int>(a) ? (getVal<int>(a) != 0) : false);
             bool bb = (holds<bool>(b)) ? getVal<bool>(b) : (holds<int>(b) ? (getVal<int>(b) != 0) : false);
             vm.stack.push_back(ab && bb);
-            break;
+            VM_NEXT();
         }
-        case OP_OR: {
+        VM_CASE(OP_OR) {
             Value b = pop(vm), a = pop(vm);
             bool ab = (holds<bool>(a)) ? getVal<bool>(a) : (holds<int>(a) ? (getVal<int>(a) != 0) : false);
             bool bb = (holds<bool>(b)) ? getVal<bool>(b) : (holds<int>(b) ? (getVal<int>(b) != 0) : false);
             vm.stack.push_back(ab || bb);
-            break;
+            VM_NEXT();
         }
 
-        case OP_XOR: {
+        VM_CASE(OP_XOR) {
             Value b = pop(vm), a = pop(vm);
 
             // Boolean XOR (logical)
@@ -4218,112 +7291,244 @@ Value runVM(VM& vm, const ObjFunction::CodeChunk& chunk) {
                 bool av = getVal<bool>(a);
                 bool bv = getVal<bool>(b);
                 vm.stack.push_back(Value(av != bv));
-                break;
+                VM_NEXT();
             }
 
             // Integer XOR (bitwise)
             if (holds<int>(a) && holds<int>(b)) {
                 vm.stack.push_back(Value(getVal<int>(a) ^ getVal<int>(b)));
-                break;
+                VM_NEXT();
             }
 
             runtimeError("VM: Xor expects (Boolean, Boolean) or (Integer, Integer).");
-            break;
+            VM_NEXT();
         }
 
 
-        case OP_PRINT: {
+        VM_CASE(OP_PRINT) {
             Value v = pop(vm);
             std::cout << valueToString(v) << std::endl;
-            break;
+            VM_NEXT();
         }
-        case OP_POP: {
-            debugLog("OP_POP: Attempting to pop a value.");
+        VM_CASE(OP_POP) {
+            DEBUG_TRACE(TRACE_VM, "OP_POP: Attempting to pop a value.");
             if (vm.stack.empty())
                 runtimeError("VM: Stack underflow on POP.");
             vm.stack.pop_back();
-            break;
+            VM_NEXT();
         }
-        case OP_DEFINE_GLOBAL: {
-            int nameIndex = chunk.code[ip++];
-            if (nameIndex < 0 || nameIndex >= (int)chunk.constants.size())
-                runtimeError("VM: Invalid constant index for global name.");
-            Value nameVal = chunk.constants[nameIndex];
-            if (!holds<std::string>(nameVal))
-                runtimeError("VM: Global name must be a string.");
-            std::string name = getVal<std::string>(nameVal);
+        VM_CASE(OP_DEFINE_GLOBAL) {
+            Symbol name = readOperand(code, ip);
             if (vm.stack.empty())
-                runtimeError("VM: Stack underflow on global definition for " + name);
+                runtimeError("VM: Stack underflow on global definition for " + symbolName(name));
             Value val = pop(vm);
             vm.environment->define(name, val);
-            debugLog("VM: Defined global variable: " + name + " = " + valueToString(val));
-            break;
-        }
-        case OP_GET_GLOBAL: {
-            int nameIndex = chunk.code[ip++];
-            if (nameIndex < 0 || nameIndex >= (int)chunk.constants.size())
-                runtimeError("VM: Invalid constant index for global name.");
-            Value nameVal = chunk.constants[nameIndex];
-            if (!holds<std::string>(nameVal))
-                runtimeError("VM: Global name must be a string.");
-            std::string name = getVal<std::string>(nameVal);
-            if (toLower(name) == "microseconds") {
+            DEBUG_TRACE(TRACE_VM, "VM: Defined global variable: " + symbolName(name) + " = " + valueToString(val));
+            VM_NEXT();
+        }
+        VM_CASE(OP_GET_GLOBAL) {
+            static const Symbol SYM_MICROSECONDS = intern("microseconds");
+            static const Symbol SYM_TICKS        = intern("ticks");
+            Symbol name = readOperand(code, ip);
+            if (name == SYM_MICROSECONDS) {
                 auto now = std::chrono::steady_clock::now();
                 double us = std::chrono::duration<double, std::micro>(now - startTime).count();
                 vm.stack.push_back(us);
-                debugLog("VM: Loaded built-in microseconds: " + std::to_string(us));
+                DEBUG_TRACE(TRACE_VM, "VM: Loaded built-in microseconds: " + std::to_string(us));
             }
-            else if (toLower(name) == "ticks") {
+            else if (name == SYM_TICKS) {
                 auto now = std::chrono::steady_clock::now();
                 double seconds = std::chrono::duration<double>(now - startTime).count();
                 int ticks = static_cast<int>(seconds * 60);
                 vm.stack.push_back(ticks);
-                debugLog("VM: Loaded built-in ticks: " + std::to_string(ticks));
+                DEBUG_TRACE(TRACE_VM, "VM: Loaded built-in ticks: " + std::to_string(ticks));
+            }
+            else if (Value* field = selfFieldCell(vm, *frame, name)) {
+                if (holds<std::shared_ptr<ObjRef>>(*field)) {
+                    auto r = getVal<std::shared_ptr<ObjRef>>(*field);
+                    if (!r || !r->target)
+                        runtimeError("ByRef: dangling nested reference for variable: " + symbolName(name));
+                    vm.stack.push_back(*(r->target));
+                } else {
+                    vm.stack.push_back(*field);
+                }
+                DEBUG_TRACE(TRACE_VM, "VM: Loaded field of self: " + symbolName(name));
             }
             else {
                 Value val = vm.environment->get(name);
                 vm.stack.push_back(val);
-                debugLog("VM: Loaded global variable: " + name + " = " + valueToString(val));
+                DEBUG_TRACE(TRACE_VM, "VM: Loaded global variable: " + symbolName(name) + " = " + valueToString(val));
             }
-            break;
+            VM_NEXT();
         }
 
-case OP_GET_REF: {
-    int nameIndex = chunk.code[ip++];
-    if (nameIndex < 0 || nameIndex >= (int)chunk.constants.size())
-        runtimeError("VM: Invalid constant index for ref name.");
-    Value nameVal = chunk.constants[nameIndex];
-    if (!holds<std::string>(nameVal))
-        runtimeError("VM: Ref name must be a string.");
-    std::string name = getVal<std::string>(nameVal);
+VM_CASE(OP_GET_REF) {
+    Symbol name = readOperand(code, ip);
 
     // ByRef requires an addressable variable cell.
-    Value* cell = vm.environment->getCell(name);
+    Value* cell = selfFieldCell(vm, *frame, name);
+    if (!cell)
+        cell = vm.environment->getCell(name);
     auto r = std::make_shared<ObjRef>();
     r->target = cell;
     vm.stack.push_back(Value(r));
-    debugLog("VM: Loaded ref for variable: " + name);
-    break;
+    DEBUG_TRACE(TRACE_VM, "VM: Loaded ref for variable: " + symbolName(name));
+    VM_NEXT();
 }
-        case OP_SET_GLOBAL: {
-            int nameIndex = chunk.code[ip++];
-            if (nameIndex < 0 || nameIndex >= (int)chunk.constants.size())
-                runtimeError("VM: Invalid constant index for global name.");
-            Value nameVal = chunk.constants[nameIndex];
-            if (!holds<std::string>(nameVal))
-                runtimeError("VM: Global name must be a string.");
-            std::string name = getVal<std::string>(nameVal);
-            Value newVal = pop(vm);
-            vm.environment->assign(name, newVal);
-            debugLog("VM: Set global variable: " + name + " = " + valueToString(newVal));
-            break;
+        VM_CASE(OP_SET_GLOBAL)
+        VM_CASE(OP_SET_GLOBAL_KEEP) {
+            Symbol name = readOperand(code, ip);
+            Value newVal = instruction == OP_SET_GLOBAL ? pop(vm) : vm.stack.back();
+            if (Value* field = selfFieldCell(vm, *frame, name)) {
+                if (holds<std::shared_ptr<ObjRef>>(*field)) {
+                    auto r = getVal<std::shared_ptr<ObjRef>>(*field);
+                    if (!r || !r->target)
+                        runtimeError("ByRef: dangling field reference assignment for variable: " + symbolName(name));
+                    *(r->target) = newVal;
+                } else {
+                    *field = newVal;
+                }
+            } else {
+                vm.environment->assign(name, newVal);
+            }
+            DEBUG_TRACE(TRACE_VM, "VM: Set global variable: " + symbolName(name) + " = " + valueToString(newVal));
+            VM_NEXT();
+        }
+        VM_CASE(OP_APPEND_LOCAL) {
+            int slot = readOperand(code, ip);
+            int count = readOperand(code, ip);
+            Value* cell = &locals[slot];
+            if (holds<std::shared_ptr<ObjRef>>(*cell)) {
+                auto r = getVal<std::shared_ptr<ObjRef>>(*cell);
+                if (!r || !r->target)
+                    runtimeError("ByRef: dangling reference assignment for local slot " + std::to_string(slot));
+                cell = r->target;
+            }
+            appendValues(*cell, vm.stack.data() + vm.stack.size() - count, count);
+            vm.stack.resize(vm.stack.size() - count);
+            VM_NEXT();
+        }
+        VM_CASE(OP_APPEND_GLOBAL) {
+            Symbol name = readOperand(code, ip);
+            int count = readOperand(code, ip);
+            Value* cell = selfFieldCell(vm, *frame, name);
+            if (!cell)
+                cell = vm.environment->getCell(name);
+            if (holds<std::shared_ptr<ObjRef>>(*cell)) {
+                auto r = getVal<std::shared_ptr<ObjRef>>(*cell);
+                if (!r || !r->target)
+                    runtimeError("ByRef: dangling reference assignment for variable: " + symbolName(name));
+                cell = r->target;
+            }
+            appendValues(*cell, vm.stack.data() + vm.stack.size() - count, count);
+            vm.stack.resize(vm.stack.size() - count);
+            VM_NEXT();
+        }
+        VM_CASE(OP_GET_LOCAL) {
+            int slot = readOperand(code, ip);
+            const Value& cell = locals[slot];
+            // ByRef parameters hold an ObjRef; read through it.
+            if (holds<std::shared_ptr<ObjRef>>(cell)) {
+                auto r = getVal<std::shared_ptr<ObjRef>>(cell);
+                if (!r || !r->target)
+                    runtimeError("ByRef: dangling reference for local slot " + std::to_string(slot));
+                vm.stack.push_back(*(r->target));
+            } else {
+                vm.stack.push_back(cell);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(OP_SET_LOCAL)
+        VM_CASE(OP_SET_LOCAL_KEEP) {
+            int slot = readOperand(code, ip);
+            Value newVal = instruction == OP_SET_LOCAL ? pop(vm) : vm.stack.back();
+            Value& cell = locals[slot];
+            if (holds<std::shared_ptr<ObjRef>>(cell)) {
+                auto r = getVal<std::shared_ptr<ObjRef>>(cell);
+                if (!r || !r->target)
+                    runtimeError("ByRef: dangling reference assignment for local slot " + std::to_string(slot));
+                *(r->target) = newVal;
+            } else {
+                cell = newVal;
+            }
+            DEBUG_TRACE(TRACE_VM, "VM: Set local slot " + std::to_string(slot) + " = " + valueToString(newVal));
+            VM_NEXT();
+        }
+        VM_CASE(OP_DEFINE_LOCAL) {
+            int slot = readOperand(code, ip);
+            locals[slot] = pop(vm);
+            VM_NEXT();
+        }
+        VM_CASE(OP_GET_LOCAL_REF) {
+            int slot = readOperand(code, ip);
+            Value& cell = locals[slot];
+            // Passing a ByRef parameter on: forward the existing reference.
+            if (holds<std::shared_ptr<ObjRef>>(cell)) {
+                vm.stack.push_back(cell);
+            } else {
+                auto r = std::make_shared<ObjRef>();
+                r->target = &cell;
+                vm.stack.push_back(Value(r));
+            }
+            VM_NEXT();
+        }
+        VM_CASE(OP_FOR_PREP) {
+            int state = readOperand(code, ip);
+            bool isDown = readOperand(code, ip) != 0;
+            int exitTarget = readJumpTarget(code, ip);
+            Value step = pop(vm), limit = pop(vm), ref = pop(vm);
+            if (!holds<std::shared_ptr<ObjRef>>(ref) || !valueRef<std::shared_ptr<ObjRef>>(ref)->target)
+                runtimeError("VM: For loop variable is not addressable.");
+            if (!isNumber(limit) || !isNumber(step))
+                runtimeError("VM: For loop limit and step must be numbers.");
+            // DownTo counts down by |step| whichever sign Step was given.
+            if (isDown)
+                step = holds<int>(step) ? Value(-std::abs(getVal<int>(step))) : Value(-std::fabs(getVal<double>(step)));
+            const Value& counter = *valueRef<std::shared_ptr<ObjRef>>(ref)->target;
+            bool enter = forLoopContinues(counter, limit, step);
+            locals[state]     = std::move(ref);
+            locals[state + 1] = std::move(limit);
+            locals[state + 2] = std::move(step);
+            if (!enter)
+                ip = exitTarget;
+            VM_NEXT();
+        }
+        VM_CASE(OP_FOR_LOOP) {
+            // Fused increment, compare and backward branch.
+            int state = readOperand(code, ip);
+            int loopTarget = readJumpTarget(code, ip);
+            Value& counter = *valueRef<std::shared_ptr<ObjRef>>(locals[state])->target;
+            const Value& limit = locals[state + 1];
+            const Value& step = locals[state + 2];
+            bool again;
+            if (holds<int>(counter) && holds<int>(limit) && holds<int>(step)) {
+                int s = valueRef<int>(step);
+                int next = valueRef<int>(counter) + s;
+                counter = next;
+                again = s >= 0 ? next <= valueRef<int>(limit) : next >= valueRef<int>(limit);
+            } else {
+                if (!isNumber(counter))
+                    runtimeError("VM: For loop counter must be a number.");
+                if (holds<int>(counter) && holds<int>(step))
+                    counter = valueRef<int>(counter) + valueRef<int>(step);
+                else
+                    counter = numberAsDouble(counter) + numberAsDouble(step);
+                again = forLoopContinues(counter, limit, step);
+            }
+            if (again) {
+                processPendingCallbacks(); // backward branch: safepoint
+                ip = loopTarget;
+            }
+            VM_NEXT();
         }
-        case OP_NEW: {
+        VM_CASE(OP_NEW) {
             Value classVal = pop(vm);
             if (!holds<std::shared_ptr<ObjClass>>(classVal))
                 runtimeError("VM: 'new' applied to non-class.");
             auto cls = getVal<std::shared_ptr<ObjClass>>(classVal);
-            if (cls->isPlugin) {
+            if (cls->nativeFactory) {
+                vm.stack.push_back(cls->nativeFactory({}));
+            } else if (cls->isPlugin) {
                 // For plugin classes, call the pluginConstructor to create a new instance.
                 Value result = cls->pluginConstructor({});
                 auto instance = std::make_shared<ObjInstance>();
@@ -4336,428 +7541,291 @@ case OP_GET_REF: {
                     // Otherwise, use the returned pointer as is.
                     instance->pluginInstance = getVal<void*>(result);
                 }
-                // Copy the plugin class properties into the instance's environment fields
-                for (auto& prop : cls->properties) {
-                    instance->fields[prop.first] = prop.second;
-                }
+                // Give the instance the plugin class's declared properties
+                instance->initFields();
                 vm.stack.push_back(Value(instance));
             } else {
                 // For built-in classes, use the standard instance creation.
                 auto instance = std::make_shared<ObjInstance>();
                 instance->klass = cls;
-                for (auto& p : cls->properties) {
-                    instance->fields[p.first] = p.second;
-                }
+                instance->initFields();
                 vm.stack.push_back(Value(instance));
             }
-            break;
+            VM_NEXT();
         }
         
 
-        case OP_DUP: {
+        VM_CASE(OP_DUP) {
             if (vm.stack.empty())
                 runtimeError("VM: Stack underflow on DUP.");
             vm.stack.push_back(vm.stack.back());
-            break;
+            VM_NEXT();
         }
 
 
-        case OP_CALL: {
-            // Number of arguments to pop
-            int argCount = chunk.code[ip++];
-            std::vector<Value> args;
-            // Pop arguments off the stack
-            for (int i = 0; i < argCount; i++) {
-                args.push_back(pop(vm));
-            }
-            // Reverse so args[0] is the first argument
-            std::reverse(args.begin(), args.end());
-        
-            // Pop the callable
-            Value callee = pop(vm);
-            debugLog("VM: Calling function with " + std::to_string(argCount) + " arguments.");
-        
-            // ---------------------------  BUILTIN  -----------------------------------
-            if (holds<BuiltinFn>(callee)) {
-                BuiltinFn fn = getVal<BuiltinFn>(callee);
-                Value result = fn(args);
-                vm.stack.push_back(result);
-            }
-        
-            // -------------------------  SCRIPTED FN  ---------------------------------
-            else if (holds<std::shared_ptr<ObjFunction>>(callee)) {
-                auto function = getVal<std::shared_ptr<ObjFunction>>(callee);
-                int total    = function->params.size();
-                int required = function->arity;
-                if ((int)args.size() < required || (int)args.size() > total) {
-                    runtimeError("VM: Expected between " +
-                                 std::to_string(required) +
-                                 " and " +
-                                 std::to_string(total) +
-                                 " arguments for function " +
-                                 function->name);
-                }
-        
-                // Fill in optional parameters
-                for (int i = args.size(); i < total; i++) {
-                    args.push_back(function->params[i].defaultValue);
-                }
-        
-                // Remember stack depth
-                size_t savedDepth = vm.stack.size();
-        
-                // Swap in new environment
-                auto previousEnv = vm.environment;
-                vm.environment = std::make_shared<Environment>(previousEnv);
-        
-                // Bind parameters
-                for (size_t i = 0; i < function->params.size(); i++) {
-                    vm.environment->define(function->params[i].name, args[i]);
-                }
-        
-                // Execute
-                Value result = runVM(vm, function->chunk);
-        
-                // Restore environment
-                vm.environment = previousEnv;
-        
-                // Clear any extra stack values left by the call, then push exactly one result
-                vm.stack.resize(savedDepth);
-                vm.stack.push_back(result);
-        
-                debugLog("VM: Function " + function->name + " returned " + valueToString(result));
-            }
-        
-            // ------------------  SCRIPTED OVERLOAD RESOLUTION  -----------------------
-            else if (holds<std::vector<std::shared_ptr<ObjFunction>>>(callee)) {
-                auto overloads = getVal<std::vector<std::shared_ptr<ObjFunction>>>(callee);
-                std::shared_ptr<ObjFunction> chosen = nullptr;
-                for (auto& f : overloads) {
-                    int total    = f->params.size();
-                    int required = f->arity;
-                    if ((int)args.size() >= required && (int)args.size() <= total) {
-                        chosen = f;
-                        break;
+        VM_CASE(OP_CALL)
+        VM_CASE(OP_TAIL_CALL) {
+            // Safepoint: run any callbacks queued by plugin threads.
+            processPendingCallbacks();
+            // Number of arguments above the callee
+            int argCount = readOperand(code, ip);
+            if ((int)vm.stack.size() < argCount + 1)
+                runtimeError("VM: Stack underflow on CALL.");
+            size_t calleeIndex = vm.stack.size() - argCount - 1;
+
+            // -------------------------  SCRIPTED CALLS  ------------------------------
+            // Functions, overload sets and scripted methods run in a new frame of
+            // this loop; the arguments move straight from the stack into its slots.
+            {
+                std::shared_ptr<ObjFunction> function;
+                Value receiver;
+                if (resolveScriptedCall(vm.stack[calleeIndex], argCount, function, receiver)) {
+                    DEBUG_TRACE(TRACE_VM, "VM: Calling " + function->name + " with " + std::to_string(argCount) + " arguments.");
+                    if (instruction == OP_TAIL_CALL && frame->function &&
+                        tailCallArgumentsMovable(vm.stack.data() + calleeIndex + 1, argCount)) {
+                        // The callee's result is this frame's result, so it
+                        // takes over the frame: the arguments move down to
+                        // where this frame's callee sat, and the frame is
+                        // popped before the new one is pushed.
+                        size_t base = frame->stackBase;
+                        for (int i = 0; i < argCount; i++)
+                            vm.stack[base + i] = std::move(vm.stack[calleeIndex + 1 + i]);
+                        vm.stack.resize(base + argCount);
+                        vm.slots.resize(frame->slotBase);
+                        vm.frames.pop_back();
+                        pushFrame(vm, function, argCount, receiver, base);
+                        loadFrame();
+                        VM_NEXT();
                     }
+                    frame->ip = ip;
+                    pushFrame(vm, function, argCount, receiver, calleeIndex);
+                    loadFrame();
+                    VM_NEXT();
                 }
-                if (!chosen) {
-                    runtimeError("VM: No matching overload found for function call with " +
-                                 std::to_string(args.size()) + " arguments.");
-                }
-        
-                // Fill in optional parameters
-                for (int i = args.size(); i < (int)chosen->params.size(); i++) {
-                    args.push_back(chosen->params[i].defaultValue);
-                }
-        
-                size_t savedDepth = vm.stack.size();
-        
-                auto previousEnv = vm.environment;
-                vm.environment = std::make_shared<Environment>(previousEnv);
-                for (size_t i = 0; i < chosen->params.size(); i++) {
-                    vm.environment->define(chosen->params[i].name, args[i]);
-                }
-        
-                Value result = runVM(vm, chosen->chunk);
-        
-                vm.environment = previousEnv;
-                vm.stack.resize(savedDepth);
-                vm.stack.push_back(result);
-        
-                debugLog("VM: Function " + chosen->name + " returned " + valueToString(result));
             }
+
+            // Everything else sees its arguments where they are on the stack;
+            // the callee and arguments are dropped once it returns.
+            DEBUG_TRACE(TRACE_VM, "VM: Calling function with " + std::to_string(argCount) + " arguments.");
+            Value result = callValue(vm, vm.stack[calleeIndex],
+                                     ArgSpan(vm.stack.data() + calleeIndex + 1, argCount));
+            vm.stack.resize(calleeIndex);
+            vm.stack.push_back(std::move(result));
+            VM_NEXT();
+        }
         
-            // ----------------------  BOUND METHOD CALL  -------------------------------
-            else if (holds<std::shared_ptr<ObjBoundMethod>>(callee)) {
-                auto bound = getVal<std::shared_ptr<ObjBoundMethod>>(callee);
-        
-                // NEW: string extension
-                if (holds<std::string>(bound->receiver)) {
-                    // look up the extension
-                    auto &exts = vm.extensionMethods["string"];
-                    auto it   = exts.find(bound->name);
-                    if (it == exts.end())
-                        runtimeError("No string extension: " + bound->name);
-                    // invoke it
-                    return getVal<BuiltinFn>(it->second)(
-                        /* prepend the receiver */ 
-                        [&]{
-                            std::vector<Value> x = args;
-                            x.insert(x.begin(), bound->receiver);
-                            return x;
-                        }()
-                    );
+        VM_CASE(OP_INDEX_GET) {
+            readOperand(code, ip);   // argc, always 1
+            Value& callee = vm.stack[vm.stack.size() - 2];
+            const Value& index = vm.stack.back();
+            if (holds<std::shared_ptr<ObjArray>>(callee) && holds<int>(index)) {
+                const ObjArray& array = *valueRef<std::shared_ptr<ObjArray>>(callee);
+                int i = getVal<int>(index);
+                if (i >= 0 && i < (int)array.size()) {
+                    callee = array.get(i);
+                    vm.stack.pop_back();
+                    VM_NEXT();
                 }
-                /* ── NEW: Integer / Double / Boolean extensions ────────────────── */
-                else if (holds<int>(bound->receiver) ||
-                        holds<double>(bound->receiver) ||
-                        holds<bool>(bound->receiver))
-                {
-                    std::string typeKey =
-                        holds<int>(bound->receiver)    ? "integer" :
-                        holds<double>(bound->receiver) ? "double"  : "boolean";
-
-                    auto &exts = vm.extensionMethods[typeKey];
-                    auto it    = exts.find(bound->name);
-                    if (it == exts.end())
-                        runtimeError("No " + typeKey + " extension: " + bound->name);
-
-                    std::vector<Value> newArgs = args;            // the call’s arguments
-                    newArgs.insert(newArgs.begin(), bound->receiver);   // prepend receiver
-
-                    Value result = getVal<BuiltinFn>(it->second)(newArgs);
-                    vm.stack.push_back(result);
-                    break;
+            }
+            // Not an in-range array read: from now on this is a plain call
+            // (which also reports the errors).
+            // In tail position (Return a(i)) the call can reuse the frame.
+            code[currentIp] = code[ip] == OP_RETURN ? OP_TAIL_CALL : OP_CALL;
+            ip = currentIp;
+            VM_NEXT();
+        }
+        VM_CASE(OP_INDEX_SET) {
+            readOperand(code, ip);   // argc, always 2
+            size_t calleeIndex = vm.stack.size() - 3;
+            Value& callee = vm.stack[calleeIndex];
+            const Value& index = vm.stack[calleeIndex + 1];
+            if (holds<std::shared_ptr<ObjArray>>(callee) && holds<int>(index) && getVal<int>(index) >= 0) {
+                ObjArray& array = *valueRef<std::shared_ptr<ObjArray>>(callee);
+                int i = getVal<int>(index);
+                // Stores past the end grow the array, as in the OP_CALL path.
+                if (i == (int)array.size())
+                    array.append(vm.stack.back());
+                else {
+                    array.growTo(i + 1);
+                    array.set(i, vm.stack.back());
                 }
-
-                // Instance methods
-                if (holds<std::shared_ptr<ObjInstance>>(bound->receiver)) {
-                    auto instance = getVal<std::shared_ptr<ObjInstance>>(bound->receiver);
-                    std::string key = toLower(bound->name);
-                    Value methodVal = instance->klass->methods[key];
-        
-                    // If it's a BuiltinFn on a plugin class, prepend handle
-                    if (holds<BuiltinFn>(methodVal) && instance->klass->isPlugin) {
-                        BuiltinFn fn = getVal<BuiltinFn>(methodVal);
-                        int handle = static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance));
-                        std::vector<Value> newArgs;
-                        newArgs.push_back(Value(handle));
-                        newArgs.insert(newArgs.end(), args.begin(), args.end());
-                        Value result = fn(newArgs);
-                        vm.stack.push_back(result);
-                    }
-                    // If it's a simple BuiltinFn
-                    else if (holds<BuiltinFn>(methodVal)) {
-                        BuiltinFn fn = getVal<BuiltinFn>(methodVal);
-                        Value result = fn(args);
-                        vm.stack.push_back(result);
-                    }
-                    // Otherwise, it's a scripted ObjFunction or overload set
-                    else {
-                        // Resolve to a single ObjFunction
-                        std::shared_ptr<ObjFunction> methodFn = nullptr;
-                        if (holds<std::shared_ptr<ObjFunction>>(methodVal)) {
-                            methodFn = getVal<std::shared_ptr<ObjFunction>>(methodVal);
-                        }
-                        else {
-                            auto overloads = getVal<std::vector<std::shared_ptr<ObjFunction>>>(methodVal);
-                            for (auto& f : overloads) {
-                                int total    = f->params.size();
-                                int required = f->arity;
-                                if ((int)args.size() >= required && (int)args.size() <= total) {
-                                    methodFn = f;
-                                    break;
-                                }
-                            }
-                        }
-                        if (!methodFn) {
-                            runtimeError("VM: No matching method found for " + bound->name);
-                        }
-        
-                        size_t savedDepth = vm.stack.size();
-        
-                        auto previousEnv = vm.environment;
-                        vm.environment = std::make_shared<Environment>(previousEnv);
-        
-                        // Define 'self'
-                        if (instance->klass->isPlugin) {
-                            int handle = static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance));
-                            vm.environment->define("self", Value(handle));
-                        } else {
-                            vm.environment->define("self", bound->receiver);
+                callee = std::move(vm.stack.back());   // the assigned value is the result
+                vm.stack.resize(calleeIndex + 1);
+                VM_NEXT();
+            }
+            // In tail position (Return f(x, y)) the call can reuse the frame.
+            code[currentIp] = code[ip] == OP_RETURN ? OP_TAIL_CALL : OP_CALL;
+            ip = currentIp;
+            VM_NEXT();
+        }
+        VM_CASE(OP_SWITCH) {
+            const SwitchTable& table = chunk->switchTables[readOperand(code, ip)];
+            ip = table.targetFor(vm.stack.back());
+            vm.stack.pop_back();
+            VM_NEXT();
+        }
+
+        VM_CASE(OP_INVOKE) {
+            processPendingCallbacks();
+            Symbol key    = readOperand(code, ip);
+            int argCount  = readOperand(code, ip);
+            PropertyCache& cache = chunk->propertyCaches[readOperand(code, ip)];
+            if ((int)vm.stack.size() < argCount + 1)
+                runtimeError("VM: Stack underflow on INVOKE.");
+            size_t receiverIndex = vm.stack.size() - argCount - 1;
+
+            // ----------------  SCRIPTED / PLUGIN INSTANCE METHOD  -----------------
+            // Found through the site's cache (or the class's method table on a
+            // miss) and called with the receiver still in place on the stack –
+            // no bound method. Fields shadow methods, as in OP_GET_PROPERTY.
+            if (holds<std::shared_ptr<ObjInstance>>(vm.stack[receiverIndex])) {
+                ObjInstance* inst = valueRef<std::shared_ptr<ObjInstance>>(vm.stack[receiverIndex]).get();
+                const Value* methodVal = nullptr;
+                bool pluginMethod = false;
+                if (inst) {
+                    const PropertyCache::Entry* hit = cache.find(inst->klass.get());
+                    if (hit) {
+                        if ((hit->kind == PropertyCache::METHOD || hit->kind == PropertyCache::PLUGIN_METHOD) &&
+                            !inst->hasExtraField(key))
+                        {
+                            methodVal = &hit->method;
+                            pluginMethod = hit->kind == PropertyCache::PLUGIN_METHOD;
                         }
-        
-                        // Bind parameters
-                        for (size_t i = 0; i < methodFn->params.size(); i++) {
-                            if (i < args.size()) {
-                                vm.environment->define(methodFn->params[i].name, args[i]);
-                            } else {
-                                vm.environment->define(
-                                    methodFn->params[i].name,
-                                    methodFn->params[i].defaultValue
-                                );
-                            }
+                    }
+                    else if (!inst->findField(key)) {
+                        auto mit = inst->klass->methods.find(key);
+                        if (mit != inst->klass->methods.end()) {
+                            methodVal = &mit->second;
+                            pluginMethod = inst->klass->isPlugin && holds<BuiltinFn>(mit->second);
+                            if (!pluginMethod && (holds<std::shared_ptr<ObjFunction>>(mit->second) ||
+                                                  holds<std::vector<std::shared_ptr<ObjFunction>>>(mit->second)))
+                                cache.record(inst->klass, PropertyCache::METHOD, -1, nullptr, mit->second);
+                            else if (pluginMethod)
+                                cache.record(inst->klass, PropertyCache::PLUGIN_METHOD, -1, nullptr, mit->second);
                         }
-        
-                        Value result = runVM(vm, methodFn->chunk);
-        
-                        vm.environment = previousEnv;
-                        vm.stack.resize(savedDepth);
-                        vm.stack.push_back(result);
-        
-                        debugLog("VM: Method " + methodFn->name + " returned " + valueToString(result));
                     }
                 }
-                // Array methods
-                else if (holds<std::shared_ptr<ObjArray>>(bound->receiver)) {
-                    auto array = getVal<std::shared_ptr<ObjArray>>(bound->receiver);
-                    Value result = callArrayMethod(array, bound->name, args);
-                    vm.stack.push_back(result);
+
+                if (methodVal && pluginMethod) {
+                    // The plugin handle takes the receiver's stack slot and
+                    // becomes argument 0; the instance is kept alive meanwhile.
+                    Value receiver = std::move(vm.stack[receiverIndex]);
+                    vm.stack[receiverIndex] = Value(static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance)));
+                    Value result = valueRef<BuiltinFn>(*methodVal)(
+                        ArgSpan(vm.stack.data() + receiverIndex, argCount + 1));
+                    vm.stack.resize(receiverIndex);
+                    vm.stack.push_back(std::move(result));
+                    VM_NEXT();
                 }
-                else {
-                    runtimeError("VM: Bound method receiver is of unsupported type.");
+                if (methodVal) {
+                    std::shared_ptr<ObjFunction> function;
+                    if (holds<std::shared_ptr<ObjFunction>>(*methodVal)) {
+                        function = valueRef<std::shared_ptr<ObjFunction>>(*methodVal);
+                    }
+                    else if (holds<std::vector<std::shared_ptr<ObjFunction>>>(*methodVal)) {
+                        function = resolveOverload(valueRef<std::vector<std::shared_ptr<ObjFunction>>>(*methodVal), argCount);
+                        if (!function)
+                            runtimeError("VM: No matching method found for " + symbolName(key));
+                    }
+                    if (function) {
+                        DEBUG_TRACE(TRACE_VM, "VM: Invoking " + function->name + " with " + std::to_string(argCount) + " arguments.");
+                        frame->ip = ip;
+                        // Scripted methods on plugin classes see the plugin handle as self.
+                        if (inst->klass->isPlugin)
+                            pushFrame(vm, function, argCount,
+                                      Value(static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance))),
+                                      receiverIndex);
+                        else
+                            pushFrame(vm, function, argCount, vm.stack[receiverIndex], receiverIndex);
+                        loadFrame();
+                        VM_NEXT();
+                    }
                 }
             }
 
-            // -----------------------  ARRAY CALL  -----------------------------------
-            else if (holds<std::shared_ptr<ObjArray>>(callee)) {
-                auto array = getVal<std::shared_ptr<ObjArray>>(callee);
-
-                /* ---------------- get item ---------------- */
-                if (argCount == 1) {
-                    Value idx = args[0];
-                    if (!holds<int>(idx))
-                        runtimeError("VM: Array index must be an Integer.");
-                    int i = getVal<int>(idx);
-                    if (i < 0 || i >= (int)array->elements.size())
-                        runtimeError("VM: Array index out of bounds.");
-                    vm.stack.push_back(array->elements[i]);
+            // -----------------------  ARRAY / DICTIONARY  ---------------------------
+            // Same result as the generic path, without binding a callable first.
+            if (holds<std::shared_ptr<ObjArray>>(vm.stack[receiverIndex]) ||
+                holds<std::shared_ptr<ObjDictionary>>(vm.stack[receiverIndex])) {
+                const Value& receiver = vm.stack[receiverIndex];
+                ArgSpan args(vm.stack.data() + receiverIndex + 1, argCount);
+                Value result = holds<std::shared_ptr<ObjArray>>(receiver)
+                    ? callArrayMethod(valueRef<std::shared_ptr<ObjArray>>(receiver), key, args)
+                    : callDictionaryMethod(valueRef<std::shared_ptr<ObjDictionary>>(receiver), key, args);
+                vm.stack.resize(receiverIndex);
+                vm.stack.push_back(std::move(result));
+                VM_NEXT();
+            }
+
+            // ---------------------------  GENERIC  ----------------------------------
+            // Anything else behaves as OP_GET_PROPERTY followed by OP_CALL,
+            // except that the lookup (and any error it raises) now comes
+            // after the arguments were evaluated.
+            {
+                Value receiver = vm.stack[receiverIndex];
+                vm.stack[receiverIndex] = getProperty(vm, receiver, key, cache);
+            }
+            {
+                std::shared_ptr<ObjFunction> function;
+                Value receiver;
+                if (resolveScriptedCall(vm.stack[receiverIndex], argCount, function, receiver)) {
+                    frame->ip = ip;
+                    pushFrame(vm, function, argCount, receiver, receiverIndex);
+                    loadFrame();
+                    VM_NEXT();
                 }
+            }
+            Value result = callValue(vm, vm.stack[receiverIndex],
+                                     ArgSpan(vm.stack.data() + receiverIndex + 1, argCount));
+            vm.stack.resize(receiverIndex);
+            vm.stack.push_back(std::move(result));
+            VM_NEXT();
+        }
 
-                /* ---------------- set item ---------------- */
-                else if (argCount == 2) {
-                    Value idx = args[0];
-                    if (!holds<int>(idx))
-                        runtimeError("VM: Array index must be an Integer.");
-                    int i = getVal<int>(idx);
-                    if (i < 0)
-                        runtimeError("VM: Array index must be ≥ 0.");
-
-                    /* auto-grow, like Xojo */
-                    if (i >= (int)array->elements.size())
-                        array->elements.resize(i + 1, Value(std::monostate{}));
-
-                    array->elements[i] = args[1];      // assign
-                    vm.stack.push_back(args[1]);       // return the new value
-                }
+        VM_CASE(OP_OPTIONAL_CALL) {
+            processPendingCallbacks();
+            int argCount = readOperand(code, ip);
+            if ((int)vm.stack.size() < argCount + 1)
+                runtimeError("VM: Stack underflow on OPTIONAL_CALL.");
+            size_t calleeIndex = vm.stack.size() - argCount - 1;
+            DEBUG_TRACE(TRACE_VM, "OP_OPTIONAL_CALL: callee type: " + getTypeName(vm.stack[calleeIndex]));
 
-                /* anything else is an error */
-                else {
-                    runtimeError("VM: Array call expects 1 (get) or 2 (set) arguments.");
-                }
-            }
-        
-            // -----------------  STRING-BASED BUILT-INS  ------------------------------
-            else if (holds<std::string>(callee)) {
-                std::string funcName = toLower(getVal<std::string>(callee));
-                if (funcName == "print") {
-                    if (args.empty()) runtimeError("VM: print expects an argument.");
-                    std::cout << valueToString(args[0]) << std::endl;
-                    vm.stack.push_back(args[0]);
-                }
-                else if (funcName == "str") {
-                    if (args.empty()) runtimeError("VM: str expects an argument.");
-                    vm.stack.push_back(Value(valueToString(args[0])));
-                }
-                else if (funcName == "ticks") {
-                    auto now = std::chrono::steady_clock::now();
-                    double seconds = std::chrono::duration<double>(now - startTime).count();
-                    vm.stack.push_back((int)(seconds * 60));
-                }
-                else if (funcName == "microseconds") {
-                    auto now = std::chrono::steady_clock::now();
-                    double us = std::chrono::duration<double, std::micro>(now - startTime).count();
-                    vm.stack.push_back(us);
-                }
-                else if (funcName == "val") {
-                    if (args.size() != 1) runtimeError("VM: val expects exactly one argument.");
-                    if (!holds<std::string>(args[0])) runtimeError("VM: val expects a string argument.");
-                    double d = std::stod(getVal<std::string>(args[0]));
-                    vm.stack.push_back(d);
-                }
-                else {
-                    runtimeError("VM: Unknown built-in function: " + funcName);
+            // Scripted constructors run in a new frame, exactly like OP_CALL.
+            {
+                std::shared_ptr<ObjFunction> function;
+                Value receiver;
+                if (resolveScriptedCall(vm.stack[calleeIndex], argCount, function, receiver)) {
+                    frame->ip = ip;
+                    pushFrame(vm, function, argCount, receiver, calleeIndex);
+                    loadFrame();
+                    VM_NEXT();
                 }
             }
-        
-            // -----------------------  INVALID CALL  ----------------------------------
-            else {
-                runtimeError("VM: Can only call functions, methods, arrays, or built-in functions.");
-            }
-        
-            break;
-        }
-        
-        case OP_OPTIONAL_CALL: {
-            int argCount = chunk.code[ip++];
+
             std::vector<Value> args;
             for (int i = 0; i < argCount; i++) {
                 args.push_back(pop(vm));
             }
             std::reverse(args.begin(), args.end());
             Value callee = pop(vm);
-            debugLog("OP_OPTIONAL_CALL: callee type: " + getTypeName(callee));
             if (holds<std::monostate>(callee)) {
-                debugLog("OP_OPTIONAL_CALL: No constructor found; skipping call.");
+                DEBUG_TRACE(TRACE_VM, "OP_OPTIONAL_CALL: No constructor found; skipping call.");
                 vm.stack.push_back(Value(std::monostate{}));   // so constructor_end sees [instance, nil]
             }
-            else if (holds<std::shared_ptr<ObjFunction>>(callee)) {
-                auto function = getVal<std::shared_ptr<ObjFunction>>(callee);
-                int total = function->params.size();
-                int required = function->arity;
-                if ((int)args.size() < required || (int)args.size() > total)
-                    runtimeError("VM: Expected between " + std::to_string(required) + " and " + std::to_string(total) + " arguments for constructor " + function->name);
-                for (int i = args.size(); i < total; i++) {
-                    args.push_back(function->params[i].defaultValue);
-                }
-                auto previousEnv = vm.environment;
-                vm.environment = std::make_shared<Environment>(previousEnv);
-                for (size_t i = 0; i < function->params.size(); i++) {
-                    vm.environment->define(function->params[i].name, args[i]);
-                }
-
-                Value result = runVM(vm, function->chunk);
-                vm.environment = previousEnv;
-                debugLog("OP_OPTIONAL_CALL: Constructor function "
-                            + function->name + " returned " + valueToString(result));
-                
-                vm.stack.push_back(result);                  //  ← always push, even if “nil”
-                    
-            }
 
-           /* ─────────────  NEW: handle bound-methods (scripted or plugin) ───────────── */
+           /* ─────────────  NEW: handle bound-methods (plugin) ───────────── */
             else if (holds<std::shared_ptr<ObjBoundMethod>>(callee)) {
 
                 auto bound = getVal<std::shared_ptr<ObjBoundMethod>>(callee);
-                std::string key = toLower(bound->name);
 
-                /* 1.  Receiver is a *scripted* instance -- fetch the target method */
+                /* 1.  Receiver is an instance -- fetch the target method */
                 if (holds<std::shared_ptr<ObjInstance>>(bound->receiver)) {
                     auto instance = getVal<std::shared_ptr<ObjInstance>>(bound->receiver);
-                    Value methodVal = instance->klass->methods[key];
-
-                    /* fall back to existing OP_CALL logic ------------------------- */
-                    // --- scripted function overload set?
-                    if (holds<std::vector<std::shared_ptr<ObjFunction>>>(methodVal))
-                        methodVal = resolveOverload(methodVal, args);   // helper you already have
-
-                    /* scripted ObjFunction */
-                    if (holds<std::shared_ptr<ObjFunction>>(methodVal)) {
-
-                        auto fn = getVal<std::shared_ptr<ObjFunction>>(methodVal);
-
-                        /* arity / default-arg handling (same as OP_CALL) */
-                        int total    = fn->params.size();
-                        int required = fn->arity;
-                        if ((int)args.size() < required || (int)args.size() > total)
-                            runtimeError("VM: Expected between " + std::to_string(required) +
-                                        " and " + std::to_string(total) + " arguments for " + fn->name);
-                        for (int i = args.size(); i < total; ++i)
-                            args.push_back(fn->params[i].defaultValue);
+                    auto mit = instance->klass->methods.find(bound->name);
+                    Value methodVal = (mit != instance->klass->methods.end()) ? mit->second : Value(std::monostate{});
 
-                        auto prevEnv = vm.environment;
-                        vm.environment = std::make_shared<Environment>(prevEnv);
-                        vm.environment->define("self", bound->receiver);          // bind Self
-
-                        for (size_t i = 0; i < fn->params.size(); ++i)
-                            vm.environment->define(fn->params[i].name, args[i]);
-
-                        Value result = runVM(vm, fn->chunk);
-                        vm.environment = prevEnv;
-                        vm.stack.push_back(result);
-                    }
                     /* builtin for plugin instance (shouldn’t happen for “constructor”, but safe) */
-                    else if (holds<BuiltinFn>(methodVal)) {
+                    if (holds<BuiltinFn>(methodVal)) {
                         BuiltinFn fn = getVal<BuiltinFn>(methodVal);
                         int handle = static_cast<int>(
                                         reinterpret_cast<intptr_t>(
@@ -4779,18 +7847,31 @@ case OP_GET_REF: {
                 runtimeError("OP_OPTIONAL_CALL: Can only call functions, bound methods, or nil.");
             }
 
-            break;
+            VM_NEXT();
         }
-        case OP_RETURN: {
-            Value ret = vm.stack.empty() ? Value(std::monostate{}) : pop(vm);
-            return ret;
+        VM_CASE(OP_RETURN) {
+            processPendingCallbacks();
+            Value result = (vm.stack.size() > frame->stackBase) ? pop(vm) : Value(std::monostate{});
+            DEBUG_TRACE(TRACE_VM, "VM: Returning " + valueToString(result));
+
+            // Drop the frame: its slots, and anything it left on the stack.
+            vm.stack.resize(frame->stackBase);
+            vm.slots.resize(frame->slotBase);
+            vm.frames.pop_back();
+            if (vm.frames.size() == entryDepth)
+                return result;
+
+            // Resume the caller with the result on its stack.
+            vm.stack.push_back(std::move(result));
+            loadFrame();
+            VM_NEXT();
         }
-        case OP_NIL: {
+        VM_CASE(OP_NIL) {
             vm.stack.push_back(Value(std::monostate{}));
-            break;
+            VM_NEXT();
         }
-        case OP_JUMP_IF_FALSE: {
-            int offset = chunk.code[ip++];
+        VM_CASE(OP_JUMP_IF_FALSE) {
+            int offset = readJumpTarget(code, ip);
             Value condition = pop(vm);
             bool condTruth = false;
             if (holds<bool>(condition))
@@ -4799,33 +7880,47 @@ case OP_GET_REF: {
                 condTruth = (getVal<int>(condition) != 0);
             else if (holds<std::string>(condition))
                 condTruth = !getVal<std::string>(condition).empty();
-            else if (std::holds_alternative<std::monostate>(condition))
+            else if (holds<std::monostate>(condition))
                 condTruth = false;
             if (!condTruth) {
                 ip = offset;
             }
-            break;
+            VM_NEXT();
         }
-        case OP_JUMP: {
-            int offset = chunk.code[ip++];
+        VM_CASE(OP_JUMP_IF_FALSE_KEEP) {
+            int offset = readJumpTarget(code, ip);
+            const Value& left = vm.stack.back();
+            if (holds<bool>(left) && !valueRef<bool>(left))
+                ip = offset;
+            VM_NEXT();
+        }
+        VM_CASE(OP_JUMP_IF_TRUE_KEEP) {
+            int offset = readJumpTarget(code, ip);
+            const Value& left = vm.stack.back();
+            if (holds<bool>(left) && valueRef<bool>(left))
+                ip = offset;
+            VM_NEXT();
+        }
+        VM_CASE(OP_JUMP) {
+            int offset = readJumpTarget(code, ip);
+            // Backward jumps close every loop, so they double as safepoints.
+            if (offset <= currentIp)
+                processPendingCallbacks();
             ip = offset;
-            break;
+            VM_NEXT();
         }
-        case OP_CLASS: {
-            int nameIndex = chunk.code[ip++];
-            Value nameVal = chunk.constants[nameIndex];
+        VM_CASE(OP_CLASS) {
+            int nameIndex = readOperand(code, ip);
+            Value nameVal = chunk->constants[nameIndex];
             if (!holds<std::string>(nameVal))
                 runtimeError("VM: Class name must be a string.");
             auto klass = std::make_shared<ObjClass>();
             klass->name = getVal<std::string>(nameVal);
             vm.stack.push_back(Value(klass));
-            break;
+            VM_NEXT();
         }
-        case OP_METHOD: {
-            int methodNameIndex = chunk.code[ip++];
-            Value methodNameVal = chunk.constants[methodNameIndex];
-            if (!holds<std::string>(methodNameVal))
-                runtimeError("VM: Method name must be a string.");
+        VM_CASE(OP_METHOD) {
+            Symbol methodName = readOperand(code, ip);
 
             // Method being attached (scripted methods are ObjFunction)
             Value newMethodVal = pop(vm);
@@ -4837,7 +7932,6 @@ case OP_GET_REF: {
                 runtimeError("VM: No class found for method.");
 
             auto klass = getVal<std::shared_ptr<ObjClass>>(classVal);
-            std::string methodName = toLower(getVal<std::string>(methodNameVal));
 
             auto it = klass->methods.find(methodName);
             if (it == klass->methods.end()) {
@@ -4863,19 +7957,19 @@ case OP_GET_REF: {
                 }
                 else if (holds<BuiltinFn>(existing)) {
                     // Keeping behavior strict here avoids surprising changes with plugin/builtin methods.
-                    runtimeError("VM: Cannot overload builtin method '" + methodName + "' with a scripted method.");
+                    runtimeError("VM: Cannot overload builtin method '" + symbolName(methodName) + "' with a scripted method.");
                 }
                 else {
-                    runtimeError("VM: Unsupported method type for overload set: " + methodName);
+                    runtimeError("VM: Unsupported method type for overload set: " + symbolName(methodName));
                 }
             }
 
             vm.stack.push_back(Value(klass));
-            break;
+            VM_NEXT();
         }
-        case OP_PROPERTIES: {
-            int propIndex = chunk.code[ip++];
-            Value propVal = chunk.constants[propIndex];
+        VM_CASE(OP_PROPERTIES) {
+            int propIndex = readOperand(code, ip);
+            Value propVal = chunk->constants[propIndex];
             if (!holds<PropertiesType>(propVal))
                 runtimeError("VM: Properties must be a property map.");
             auto props = getVal<PropertiesType>(propVal);
@@ -4885,278 +7979,139 @@ case OP_GET_REF: {
             auto klass = getVal<std::shared_ptr<ObjClass>>(classVal);
             klass->properties = props;
             vm.stack.push_back(Value(klass));
-            break;
-        }
-        case OP_ARRAY: {
-            int count = chunk.code[ip++];
-            std::vector<Value> elems;
-            for (int i = 0; i < count; i++) {
-                elems.push_back(pop(vm));
-            }
-            std::reverse(elems.begin(), elems.end());
-            auto array = std::make_shared<ObjArray>();
-            array->elements = elems;
+            VM_NEXT();
+        }
+        VM_CASE(OP_ARRAY) {
+            int count = readOperand(code, ip);
+            auto storage = static_cast<ObjArray::Storage>(readOperand(code, ip));
+            std::vector<Value> elems(vm.stack.end() - count, vm.stack.end());
+            vm.stack.resize(vm.stack.size() - count);
+            auto array = std::make_shared<ObjArray>(storage);
+            array->assign(std::move(elems));
             vm.stack.push_back(Value(array));
-            debugLog("VM: Created array with " + std::to_string(count) + " elements.");
-            break;
+            DEBUG_TRACE(TRACE_VM, "VM: Created array with " + std::to_string(count) + " elements.");
+            VM_NEXT();
         }
 
 
-        case OP_GET_PROPERTY:
+        VM_CASE(OP_GET_PROPERTY)
         {
-            // constant index of the property name
-            int nameIndex = chunk.code[ip++];
-            if (nameIndex < 0 || nameIndex >= (int)chunk.constants.size() ||
-                !holds<std::string>(chunk.constants[nameIndex]))
-            {
-                runtimeError("OP_GET_PROPERTY: name constant is not a string");
-            }
-
-            std::string name      = getVal<std::string>(chunk.constants[nameIndex]);
-            std::string lowerName = toLower(name);
+            // the property name, then the site's inline cache
+            Symbol key = readOperand(code, ip);
+            PropertyCache& cache = chunk->propertyCaches[readOperand(code, ip)];
 
             if (vm.stack.empty())
                 runtimeError("OP_GET_PROPERTY: stack underflow");
 
-            // Object whose property/method we’re accessing
-            Value receiver = pop(vm);
-
-
-            // --------------------------------------------------------
-            // 0) Enums – EnumName.Member
-            // --------------------------------------------------------
-            {
-                Value enumOut;
-                if (tryGetEnumMember(receiver, lowerName, enumOut)) {
-                    vm.stack.push_back(enumOut);
-                    break;
-                }
-            }
-
             // --------------------------------------------------------
-            // 1) Instance fields / methods (including plugin classes)
+            // Inline cache hit: an instance of a class this site has seen.
+            // Fields shadow class members, so a cached getter/method only
+            // applies while the instance has no field of that name.
             // --------------------------------------------------------
-            if (holds<std::shared_ptr<ObjInstance>>(receiver)) {
-                auto inst  = getVal<std::shared_ptr<ObjInstance>>(receiver);
-                auto klass = inst ? inst->klass : nullptr;
-
-                // Instance fields first
-                if (inst) {
-                    auto fIt = inst->fields.find(lowerName);
-                    if (fIt != inst->fields.end()) {
-                        vm.stack.push_back(fIt->second);
-                        break;
+            if (cache.count && holds<std::shared_ptr<ObjInstance>>(vm.stack.back())) {
+                const auto& inst = valueRef<std::shared_ptr<ObjInstance>>(vm.stack.back());
+                const PropertyCache::Entry* hit = inst ? cache.find(inst->klass.get()) : nullptr;
+                if (hit) {
+                    if (hit->kind == PropertyCache::FIELD) {
+                        if (hit->slot < (int)inst->slots.size()) {
+                            Value result = inst->slots[hit->slot];
+                            vm.stack.back() = std::move(result);
+                            VM_NEXT();
+                        }
                     }
-                }
-
-                // Plugin-backed properties (getter)
-                if (inst && klass && klass->isPlugin) {
-                    auto pit = klass->pluginProperties.find(lowerName);
-                    if (pit != klass->pluginProperties.end()) {
-                        BuiltinFn getter = pit->second.first;
-                        if (!getter)
-                            runtimeError("Property '" + name + "' does not have a getter.");
-
+                    else if (!inst->hasExtraField(key)) {
                         int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
-                        Value result = getter({ Value(handle) });
-                        vm.stack.push_back(result);
-                        break;
-                    }
-                }
-
-                // Class methods
-                if (inst && klass) {
-                    auto mit = klass->methods.find(lowerName);
-                    if (mit != klass->methods.end()) {
-                        Value methVal = mit->second;
-
-                        // Plugin methods – bind the handle as the first arg.
-                        if (klass->isPlugin && holds<BuiltinFn>(methVal)) {
-                            BuiltinFn raw = getVal<BuiltinFn>(methVal);
-                            int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
-                            BuiltinFn bound = [raw, handle](const std::vector<Value>& args) -> Value {
+                        Value result;
+                        if (hit->kind == PropertyCache::PLUGIN_GETTER) {
+                            Value callArgs[] = { Value(handle) };
+                            result = (*hit->accessor)(ArgSpan(callArgs, 1));
+                        }
+                        else if (hit->kind == PropertyCache::METHOD) {
+                            auto bm = std::make_shared<ObjBoundMethod>();
+                            bm->receiver = vm.stack.back();
+                            bm->name     = key;
+                            result = Value(bm);
+                        }
+                        else {
+                            BuiltinFn raw = valueRef<BuiltinFn>(hit->method);
+                            result = Value(BuiltinFn([raw, handle](ArgSpan args) -> Value {
                                 std::vector<Value> full;
                                 full.reserve(args.size() + 1);
                                 full.emplace_back(handle);
                                 full.insert(full.end(), args.begin(), args.end());
                                 return raw(full);
-                            };
-                            vm.stack.push_back(Value(bound));
-                            break;
+                            }));
                         }
-
-                        // Scripted method – return bound-method object
-                        auto bm = std::make_shared<ObjBoundMethod>();
-                        bm->receiver = receiver;
-                        bm->name     = lowerName;
-                        vm.stack.push_back(Value(bm));
-                        break;
+                        vm.stack.back() = std::move(result);
+                        VM_NEXT();
                     }
                 }
-
-                // If we fall through, we’ll still give extension methods a chance
-                // and then the legacy "constructor" / "tostring" / plugin fallback below.
-            }
-
-            // --------------------------------------------------------
-            // 2) Arrays – expose methods (Add, Count, Join, etc.)
-            // --------------------------------------------------------
-            if (holds<std::shared_ptr<ObjArray>>(receiver)) {
-                auto arr = getVal<std::shared_ptr<ObjArray>>(receiver);
-
-                // Return a callable that dispatches to callArrayMethod(...)
-                BuiltinFn bound = [arr, lowerName](const std::vector<Value>& args) -> Value {
-                    return callArrayMethod(arr, lowerName, args);
-                };
-                vm.stack.push_back(Value(bound));
-                break;
-            }
-
-            // --------------------------------------------------------
-            // 3) Modules – module.member
-            // --------------------------------------------------------
-            if (holds<std::shared_ptr<ObjModule>>(receiver)) {
-                auto mod = getVal<std::shared_ptr<ObjModule>>(receiver);
-                auto it  = mod->publicMembers.find(lowerName);
-                if (it != mod->publicMembers.end()) {
-                    vm.stack.push_back(it->second);
-                    break;
-                }
-                // fall through for extension methods / constructor / tostring / plugin fallback
-            }
-
-            // --------------------------------------------------------
-            // 4) Classes – static methods
-            // --------------------------------------------------------
-            if (holds<std::shared_ptr<ObjClass>>(receiver)) {
-                auto cls = getVal<std::shared_ptr<ObjClass>>(receiver);
-                auto mit = cls->methods.find(lowerName);
-                if (mit != cls->methods.end()) {
-                    vm.stack.push_back(mit->second);
-                    break;
-                }
-                // fall through for extension methods / constructor / tostring / plugin fallback
             }
 
-            // --------------------------------------------------------
-            // 5) EXTENSION METHODS on primitives (Integer, Double, String, …)
-            // --------------------------------------------------------
-            {
-                Value ext = bindExtensionMethod(vm, receiver, lowerName);
-                if (!holds<std::monostate>(ext)) {
-                    // ext is already a callable (BuiltinFn) bound to this receiver.
-                    vm.stack.push_back(ext);
-                    break;
-                }
-            }
-
-            // --------------------------------------------------------
-            // 5.5) Legacy ".constructor" sentinel
-            //
-            // Older bytecode and the plugin class machinery sometimes probe
-            // `.constructor` just to see if anything is there. Historically this
-            // did NOT throw – it pushed a "no ctor" sentinel instead.
-            // --------------------------------------------------------
-            if (lowerName == "constructor") {
-                vm.stack.push_back(Value(std::monostate{})); // "no ctor" sentinel
-                break;
-            }
-
-            // --------------------------------------------------------
-            // 6) Built-in .tostring on core types (after extensions / ctor)
-            //
-            // Mirrors the old behavior:
-            //   - String: returns the raw string (no extra quoting)
-            //   - Int/Double/Arrays/Instances/etc: valueToString(receiver)
-            // --------------------------------------------------------
-            if (lowerName == "tostring") {
-                if (holds<std::string>(receiver)) {
-                    // Old semantics: for string, just return the string itself.
-                    const std::string& s = getVal<std::string>(receiver);
-                    vm.stack.push_back(Value(s));
-                } else {
-                    vm.stack.push_back(Value(valueToString(receiver)));
-                }
-                break;
-            }
+            // Object whose property/method we’re accessing
+            Value receiver = pop(vm);
+            Value result = getProperty(vm, receiver, key, cache);
+            vm.stack.push_back(std::move(result));
+            VM_NEXT();
+        }
 
-            // --------------------------------------------------------
-            // 7) Optional: built-in string helpers AFTER extension / tostring
-            // --------------------------------------------------------
-            if (holds<std::string>(receiver)) {
-                const std::string& s = getVal<std::string>(receiver);
 
-                if (lowerName == "length") {
-                    vm.stack.push_back((int)s.size());
-                    break;
-                }
-                // Add other built-in string properties/methods here if needed.
-            }
+        VM_CASE(OP_SET_PROPERTY) {
+            Symbol propName = readOperand(code, ip);
+            PropertyCache& cache = chunk->propertyCaches[readOperand(code, ip)];
+            Value value = pop(vm);
+            Value object = pop(vm);
 
-            // --------------------------------------------------------
-            // 8) FINAL PLUGIN INSTANCE FALLBACK (for things like ".handle")
-            //
-            // This restores the old behavior:
-            //   unknown plugin property ⇒ "ClassName:handle:propName"
-            // so that ClassObject.handle and similar patterns work.
-            // --------------------------------------------------------
-            if (holds<std::shared_ptr<ObjInstance>>(receiver)) {
-                auto inst  = getVal<std::shared_ptr<ObjInstance>>(receiver);
-                auto klass = inst ? inst->klass : nullptr;
-                if (inst && klass && klass->isPlugin) {
-                    int handle = static_cast<int>(reinterpret_cast<intptr_t>(inst->pluginInstance));
-                    std::string target = klass->name + ":" +
-                                        std::to_string(handle) + ":" +
-                                        lowerName;
-                    vm.stack.push_back(Value(target));
-                    break;
+            // Inline cache hit: setter or plain field store, decided per class.
+            if (cache.count && holds<std::shared_ptr<ObjInstance>>(object)) {
+                const auto& instance = valueRef<std::shared_ptr<ObjInstance>>(object);
+                if (const PropertyCache::Entry* hit = cache.find(instance->klass.get())) {
+                    if (hit->kind == PropertyCache::PLUGIN_SETTER) {
+                        int handle = static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance));
+                        Value callArgs[] = { Value(handle), value };
+                        (*hit->accessor)(ArgSpan(callArgs, 2));
+                    } else if (hit->slot < (int)instance->slots.size()) {
+                        instance->slots[hit->slot] = std::move(value);
+                    } else {
+                        instance->fieldRef(propName) = std::move(value);
+                    }
+                    vm.stack.push_back(std::move(object));
+                    VM_NEXT();
                 }
             }
 
-            // If nothing matched, this really is an error.
-            runtimeError("Undefined property or method '" + name + "'");
-            break;
-        }
-
-
-        case OP_SET_PROPERTY: {
-            int propNameIndex = chunk.code[ip++];
-            Value propNameVal = chunk.constants[propNameIndex];
-            if (!holds<std::string>(propNameVal))
-                runtimeError("VM: Property name must be a string.");
-            std::string propName = toLower(getVal<std::string>(propNameVal));
-            Value value = pop(vm);
-            Value object = pop(vm);
-            debugLog("OP_SET_PROPERTY: About to set property '" + propName + "'.");
-            debugLog("OP_SET_PROPERTY: Value = " + valueToString(value));
-            debugLog("OP_SET_PROPERTY: Object type = " + getTypeName(object) + " (" + valueToString(object) + ")");
+            DEBUG_TRACE(TRACE_VM, "OP_SET_PROPERTY: About to set property '" + symbolName(propName) + "'.");
+            DEBUG_TRACE(TRACE_VM, "OP_SET_PROPERTY: Value = " + valueToString(value));
+            DEBUG_TRACE(TRACE_VM, "OP_SET_PROPERTY: Object type = " + getTypeName(object) + " (" + valueToString(object) + ")");
             if (holds<std::shared_ptr<ObjInstance>>(object)) {
                 auto instance = getVal<std::shared_ptr<ObjInstance>>(object);
                 if (instance->klass->isPlugin) {
                     // For plugin instances, look for an explicit setter.
                     auto it = instance->klass->pluginProperties.find(propName);
                     if (it != instance->klass->pluginProperties.end()) {
+                        cache.record(instance->klass, PropertyCache::PLUGIN_SETTER, -1, &it->second.second);
                         int handle = static_cast<int>(reinterpret_cast<intptr_t>(instance->pluginInstance));
                         BuiltinFn setter = it->second.second;
-                        setter({ Value(handle), value });
+                        Value callArgs[] = { Value(handle), value };
+                        setter(ArgSpan(callArgs, 2));
                         vm.stack.push_back(object);
                     } else {
-                        // Fallback: store the value in the instance's field map.
-                        instance->fields[propName] = value;
+                        // Fallback: store the value in the instance's fields.
+                        storeField(cache, *instance, propName, value);
                         vm.stack.push_back(object);
                     }
                 } else {
-                    instance->fields[propName] = value;
+                    storeField(cache, *instance, propName, value);
                     vm.stack.push_back(object);
                 }
             } else {
                 runtimeError("VM: Can only set properties on instances. Instead got type: " + getTypeName(object));
             }
-            break;
+            VM_NEXT();
         }
 
 
-        case OP_CONSTRUCTOR_END: {
+        VM_CASE(OP_CONSTRUCTOR_END) {
             if (vm.stack.size() < 2)
                 runtimeError("VM: Not enough values for constructor end.");
             Value constructorResult = pop(vm);
@@ -5165,23 +8120,23 @@ case OP_GET_REF: {
                 vm.stack.push_back(instance);
             else
                 vm.stack.push_back(constructorResult);
-            break;
+            VM_NEXT();
         }
 
 
-        case OP_NOT: {
+        VM_CASE(OP_NOT) {
             Value v = pop(vm);
 
             // Boolean NOT
             if (holds<bool>(v)) {
                 vm.stack.push_back(!getVal<bool>(v));
-                break;
+                VM_NEXT();
             }
 
             // Integer NOT (bitwise complement)
             if (holds<int>(v)) {
                 vm.stack.push_back(~getVal<int>(v));
-                break;
+                VM_NEXT();
             }
 
             // Optional: allow whole-number doubles by coercing to int
@@ -5193,27 +8148,53 @@ case OP_GET_REF: {
                     ipart <= (double)std::numeric_limits<int>::max())
                 {
                     vm.stack.push_back(~(int)ipart);
-                    break;
+                    VM_NEXT();
                 }
             }
 
             runtimeError("VM: Operand must be Boolean or Integer for Not.");
-            break;
-        }
-
+            VM_NEXT();
+        }
+
+
+        VM_CASE(OP_ADD_II)    VM_QUICK_BINARY(OP_ADD, int, a + b)
+        VM_CASE(OP_ADD_DD)    VM_QUICK_BINARY(OP_ADD, double, a + b)
+        VM_CASE(OP_CONCAT_SS) {
+            // Appends into the left operand, which is usually the unshared
+            // temporary from the previous + in a chain.
+            Value& lhs = vm.stack[vm.stack.size() - 2];
+            const Value& rhs = vm.stack.back();
+            if (holds<std::string>(lhs) && holds<std::string>(rhs)) {
+                appendValues(lhs, &rhs, 1);
+                vm.stack.pop_back();
+                VM_NEXT();
+            }
+            code[currentIp] = OP_ADD;
+            ip = currentIp;
+            VM_NEXT();
+        }
+        VM_CASE(OP_SUB_II)    VM_QUICK_BINARY(OP_SUB, int, a - b)
+        VM_CASE(OP_SUB_DD)    VM_QUICK_BINARY(OP_SUB, double, a - b)
+        VM_CASE(OP_MUL_II)    VM_QUICK_BINARY(OP_MUL, int, a * b)
+        VM_CASE(OP_MUL_DD)    VM_QUICK_BINARY(OP_MUL, double, a * b)
+        VM_CASE(OP_MOD_II)    VM_QUICK_BINARY(OP_MOD, int, a % b)
+        VM_CASE(OP_LT_II)     VM_QUICK_BINARY(OP_LT, int, a < b)
+        VM_CASE(OP_LT_DD)     VM_QUICK_BINARY(OP_LT, double, a < b)
+        VM_CASE(OP_LE_II)     VM_QUICK_BINARY(OP_LE, int, a <= b)
+        VM_CASE(OP_LE_DD)     VM_QUICK_BINARY(OP_LE, double, a <= b)
+        VM_CASE(OP_GT_II)     VM_QUICK_BINARY(OP_GT, int, a > b)
+        VM_CASE(OP_GT_DD)     VM_QUICK_BINARY(OP_GT, double, a > b)
+        VM_CASE(OP_GE_II)     VM_QUICK_BINARY(OP_GE, int, a >= b)
+        VM_CASE(OP_GE_DD)     VM_QUICK_BINARY(OP_GE, double, a >= b)
+        VM_CASE(OP_EQ_II)     VM_QUICK_BINARY(OP_EQ, int, a == b)
+        VM_CASE(OP_NE_II)     VM_QUICK_BINARY(OP_NE, int, a != b)
 
         default:
             break;
         }
-        {
-            std::string s = "[";
-            for (auto& v : vm.stack)
-                s += valueToString(v) + ", ";
-            s += "]";
-            debugLog("VM: Stack after execution: " + s);
-        }
+        if (traceEnabled(TRACE_STACK))
+            traceStack(vm);
     }
-    return Value(std::monostate{});
 }
 
 const char MARKER[9] = "BYTECODE"; // 8 characters + null terminator = 9
@@ -5228,7 +8209,7 @@ std::string retrieveData(const std::string& exePath) {
     exeFile.seekg(0, std::ios::end);
     std::streampos fileSize = exeFile.tellg();
     if (fileSize < 12) { // at least marker (8 bytes) + length (4 bytes)
-        debugLog("No bytecode data found.\n");
+        DEBUG_TRACE(TRACE_GENERAL, "No bytecode data found.\n");
         return "";
     }
     // Read the last 12 bytes: marker (8) and text length (4)
@@ -5239,12 +8220,12 @@ std::string retrieveData(const std::string& exePath) {
     exeFile.read(reinterpret_cast<char*>(&textLength), sizeof(textLength));
     // Verify marker
     if (std::strncmp(markerBuffer, MARKER, 8) != 0) {
-        debugLog("Bytecode not found.\n");
+        DEBUG_TRACE(TRACE_GENERAL, "Bytecode not found.\n");
         return "";
     }
     // Ensure file contains enough data for the embedded text
     if (fileSize < static_cast<std::streamoff>(12 + textLength)) {
-        debugLog("Invalid bytecode data length.\n");
+        DEBUG_TRACE(TRACE_GENERAL, "Invalid bytecode data length.\n");
         return "";
     }
     // Calculate position of text data
@@ -5277,7 +8258,7 @@ void InitializeEnvironment(VM& vm) {
         vm.environment->define("endofline", nativeEndOfLine);
         vm.environment->define("eol", nativeEndOfLine);
 
-        vm.environment->define("sortwith", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("sortwith", BuiltinFn([](ArgSpan args) -> Value {
             // Check that exactly 2 arguments were passed.
             if (args.size() != 2)
                 runtimeError("sortwith expects exactly 2 arguments.");
@@ -5290,10 +8271,10 @@ void InitializeEnvironment(VM& vm) {
             auto arr2 = getVal<std::shared_ptr<ObjArray>>(args[1]);
         
             // They must be of equal length.
-            if (arr1->elements.size() != arr2->elements.size())
+            if (arr1->size() != arr2->size())
                 runtimeError("sortwith: both arrays must have the same number of elements.");
         
-            size_t n = arr1->elements.size();
+            size_t n = arr1->size();
             // Create an index vector [0, 1, 2, ... n-1]
             std::vector<size_t> indices(n);
             for (size_t i = 0; i < n; i++) {
@@ -5302,8 +8283,8 @@ void InitializeEnvironment(VM& vm) {
         
             // Sort the indices based on the values in arr1.
             std::sort(indices.begin(), indices.end(), [arr1](size_t i, size_t j) {
-                const Value &a = arr1->elements[i];
-                const Value &b = arr1->elements[j];
+                const Value a = arr1->get(i);
+                const Value b = arr1->get(j);
                 // First, if both are int, compare as integers.
                 if (holds<int>(a) && holds<int>(b))
                     return getVal<int>(a) < getVal<int>(b);
@@ -5320,13 +8301,13 @@ void InitializeEnvironment(VM& vm) {
             // Create new sorted vectors for both arrays.
             std::vector<Value> newArr1(n), newArr2(n);
             for (size_t i = 0; i < n; i++) {
-                newArr1[i] = arr1->elements[indices[i]];
-                newArr2[i] = arr2->elements[indices[i]];
+                newArr1[i] = arr1->get(indices[i]);
+                newArr2[i] = arr2->get(indices[i]);
             }
         
             // Replace the contents of the original arrays with the sorted ones.
-            arr1->elements = newArr1;
-            arr2->elements = newArr2;
+            arr1->assign(std::move(newArr1));
+            arr2->assign(std::move(newArr2));
         
             // sortwith is a procedure so we return nil.
             return Value(std::monostate{});
@@ -5335,7 +8316,7 @@ void InitializeEnvironment(VM& vm) {
         // ------------------------------------------------------------------
         // Built‑in IIF: IIF(condition, trueValue, falseValue)
         // ------------------------------------------------------------------
-        vm.environment->define("iif", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("iif", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 3)
                 runtimeError("IIF expects exactly three arguments: IIF(condition, trueVal, falseVal).");
 
@@ -5358,7 +8339,7 @@ void InitializeEnvironment(VM& vm) {
         // -----------------------------------------------------------------------------
 
         // Beep(Frequency As Integer, Duration As Integer) As Boolean
-        vm.environment->define("beep", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("beep", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2) runtimeError("Beep expects 2 arguments: frequency, duration.");
 
             int freq;
@@ -5391,7 +8372,7 @@ void InitializeEnvironment(VM& vm) {
         }));
 
         // Sleep(Milliseconds As Integer) As Boolean
-        vm.environment->define("sleep", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("sleep", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Sleep expects 1 argument: milliseconds.");
 
             int ms;
@@ -5413,7 +8394,7 @@ void InitializeEnvironment(VM& vm) {
 
         // DoEvents(Milliseconds As Integer) As Boolean
         // — processes UI/events, then sleeps for the given ms
-        vm.environment->define("doevents", BuiltinFn([&](const std::vector<Value>& args) -> Value {
+        vm.environment->define("doevents", BuiltinFn([&](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("DoEvents expects 1 argument: milliseconds.");
 
             int ms;
@@ -5440,12 +8421,13 @@ void InitializeEnvironment(VM& vm) {
 
             // then sleep
             auto sleepFn = getVal<BuiltinFn>(vm.environment->get("sleep"));
-            sleepFn({ Value(ms) });
+            Value callArgs[] = { Value(ms) };
+            sleepFn(ArgSpan(callArgs, 1));
             return Value(true);
         }));
 
         // IsNumeric(Text As String) As Boolean
-        vm.environment->define("isnumeric", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("isnumeric", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("IsNumeric expects 1 argument: text.");
 
             std::string s;
@@ -5466,13 +8448,13 @@ void InitializeEnvironment(VM& vm) {
 
         
         // Define built-in functions.
-        vm.environment->define("print", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("print", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() < 1) runtimeError("print expects an argument.");
             std::cout << valueToString(args[0]) << std::endl;
             return args[0];
         }));
 
-        vm.environment->define("input", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("input", BuiltinFn([](ArgSpan args) -> Value {
             if (!args.empty())
                 runtimeError("Input() expects no arguments.");
             std::string userInput;
@@ -5482,7 +8464,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: replace(input, findText, replaceWith)
         // Replaces the first occurrence of findText in input with replaceWith.
-        vm.environment->define("replace", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("replace", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 3)
                 runtimeError("replace expects exactly 3 arguments: input, findText, replaceWith.");
             if (!holds<std::string>(args[0]) || !holds<std::string>(args[1]) || !holds<std::string>(args[2]))
@@ -5499,7 +8481,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: replaceall(input, findText, replacement)
         // Replaces all occurrences of findText in input with replacement.
-        vm.environment->define("replaceall", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("replaceall", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 3)
                 runtimeError("replaceall expects exactly 3 arguments: input, findText, replacement.");
             if (!holds<std::string>(args[0]) || !holds<std::string>(args[1]) || !holds<std::string>(args[2]))
@@ -5517,7 +8499,7 @@ void InitializeEnvironment(VM& vm) {
             return Value(input);
         }));
 
-        vm.environment->define("length", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("length", BuiltinFn([](ArgSpan args) -> Value {
             // len expects exactly one argument
             if (args.size() != 1) runtimeError("length expects exactly one argument.");
         
@@ -5529,7 +8511,7 @@ void InitializeEnvironment(VM& vm) {
             // array case
             else if (holds<std::shared_ptr<ObjArray>>(args[0])) {
                 auto arr = getVal<std::shared_ptr<ObjArray>>(args[0]);
-                return Value((int)arr->elements.size());
+                return Value((int)arr->size());
             }
             else {
                 runtimeError("length expects a string or an array.");
@@ -5538,7 +8520,7 @@ void InitializeEnvironment(VM& vm) {
             }
         }));
 
-        vm.environment->define("len", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("len", BuiltinFn([](ArgSpan args) -> Value {
             // len expects exactly one argument
             if (args.size() != 1) runtimeError("len expects exactly one argument.");
         
@@ -5550,7 +8532,7 @@ void InitializeEnvironment(VM& vm) {
             // array case
             else if (holds<std::shared_ptr<ObjArray>>(args[0])) {
                 auto arr = getVal<std::shared_ptr<ObjArray>>(args[0]);
-                return Value((int)arr->elements.size());
+                return Value((int)arr->size());
             }
             else {
                 runtimeError("len expects a string or an array.");
@@ -5559,7 +8541,7 @@ void InitializeEnvironment(VM& vm) {
             }
         }));
         
-        vm.environment->define("space", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("space", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("space expects exactly one argument.");
             
             int count;
@@ -5578,7 +8560,7 @@ void InitializeEnvironment(VM& vm) {
             return Value(std::string(count, ' '));
         }));
 
-        vm.environment->define("quit", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("quit", BuiltinFn([](ArgSpan args) -> Value {
             if (!args.empty()) runtimeError("quit expects no arguments.");
             // flush any pending output
             std::cout << std::flush;
@@ -5588,13 +8570,13 @@ void InitializeEnvironment(VM& vm) {
         }));
         
 
-        vm.environment->define("str", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("str", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() < 1) runtimeError("str expects an argument.");
             return Value(valueToString(args[0]));
         }));
         vm.environment->define("microseconds", std::string("microseconds"));
         vm.environment->define("ticks", std::string("ticks"));
-        vm.environment->define("val", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("val", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("val expects exactly one argument.");
             if (!holds<std::string>(args[0]))
                 runtimeError("val expects a string argument.");
@@ -5607,7 +8589,7 @@ void InitializeEnvironment(VM& vm) {
         //   - inputStringArray must be an Array of String
         //   - separator must be a String
         // Returns the concatenation of all elements, separated by separator.
-        vm.environment->define("join", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("join", BuiltinFn([](ArgSpan args) -> Value {
             // Expect exactly two arguments
             if (args.size() != 2)
                 runtimeError("join expects exactly two arguments: inputStringArray and separator.");
@@ -5625,19 +8607,19 @@ void InitializeEnvironment(VM& vm) {
 
             // Build the result
             std::string result;
-            for (size_t i = 0; i < arr->elements.size(); ++i) {
+            for (size_t i = 0; i < arr->size(); ++i) {
                 // Each element must be a string (or convertible)
-                if (!holds<std::string>(arr->elements[i]))
+                if (arr->storage != ObjArray::Storage::VALUES || !holds<std::string>(arr->elements[i]))
                     runtimeError("join: all array elements must be strings.");
                 result += getVal<std::string>(arr->elements[i]);
-                if (i + 1 < arr->elements.size())
+                if (i + 1 < arr->size())
                     result += sep;
             }
             return Value(result);
         }));
 
 
-        vm.environment->define("split", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("split", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2)
                 runtimeError("split expects exactly two arguments: text and delimiter.");
             if (!holds<std::string>(args[0]) || !holds<std::string>(args[1]))
@@ -5661,12 +8643,24 @@ void InitializeEnvironment(VM& vm) {
             }
             return Value(arr);
         }));
-        vm.environment->define("array", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("array", BuiltinFn([](ArgSpan args) -> Value {
             auto arr = std::make_shared<ObjArray>();
-            arr->elements = args;
+            arr->elements.assign(args.begin(), args.end());
             return Value(arr);
         }));
-        vm.environment->define("abs", BuiltinFn([](const std::vector<Value>& args) -> Value {
+
+        // Dictionary: `New Dictionary` gives a native hash table (see
+        // callDictionaryMethod). A script that declares its own Class
+        // Dictionary replaces this global as usual.
+        {
+            auto dictionaryClass = std::make_shared<ObjClass>();
+            dictionaryClass->name = "Dictionary";
+            dictionaryClass->nativeFactory = [](ArgSpan) -> Value {
+                return Value(std::make_shared<ObjDictionary>());
+            };
+            vm.environment->define("dictionary", Value(dictionaryClass));
+        }
+        vm.environment->define("abs", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Abs expects exactly one argument.");
             if (holds<int>(args[0]))
                 return std::abs(getVal<int>(args[0]));
@@ -5676,12 +8670,12 @@ void InitializeEnvironment(VM& vm) {
                 runtimeError("Abs expects a number.");
             return Value(std::monostate{});
         }));
-        vm.environment->define("acos", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("acos", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Acos expects exactly one argument.");
             double x = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Acos expects a number."), 0.0));
             return std::acos(x);
         }));
-        vm.environment->define("asc", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("asc", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Asc expects exactly one argument.");
             if (!holds<std::string>(args[0]))
                 runtimeError("Asc expects a string.");
@@ -5689,48 +8683,48 @@ void InitializeEnvironment(VM& vm) {
             if (s.empty()) runtimeError("Asc expects a non-empty string.");
             return (int)s[0];
         }));
-        vm.environment->define("asin", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("asin", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Asin expects exactly one argument.");
             double x = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Asin expects a number."), 0.0));
             return std::asin(x);
         }));
-        vm.environment->define("atan", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("atan", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Atan expects exactly one argument.");
             double x = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Atan expects a number."), 0.0));
             return std::atan(x);
         }));
-        vm.environment->define("atan2", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("atan2", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2) runtimeError("Atan2 expects exactly two arguments.");
             double y = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Atan2 expects numbers."), 0.0));
             double x = holds<int>(args[1]) ? getVal<int>(args[1]) : (holds<double>(args[1]) ? getVal<double>(args[1]) : (runtimeError("Atan2 expects numbers."), 0.0));
             return std::atan2(y, x);
         }));
-        vm.environment->define("ceiling", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("ceiling", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Ceiling expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Ceiling expects a number."), 0.0));
             return std::ceil(v);
         }));
-        vm.environment->define("cos", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("cos", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Cos expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Cos expects a number."), 0.0));
             return std::cos(v);
         }));
-        vm.environment->define("exp", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("exp", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Exp expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Exp expects a number."), 0.0));
             return std::exp(v);
         }));
-        vm.environment->define("floor", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("floor", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Floor expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Floor expects a number."), 0.0));
             return std::floor(v);
         }));
-        vm.environment->define("log", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("log", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Log expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : (holds<double>(args[0]) ? getVal<double>(args[0]) : (runtimeError("Log expects a number."), 0.0));
             return std::log(v);
         }));
-        vm.environment->define("max", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("max", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2) runtimeError("Max expects exactly two arguments.");
             if (holds<int>(args[0]) && holds<int>(args[1])) {
                 int a = getVal<int>(args[0]), b = getVal<int>(args[1]);
@@ -5742,7 +8736,7 @@ void InitializeEnvironment(VM& vm) {
                 return a > b ? a : b;
             }
         }));
-        vm.environment->define("min", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("min", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2) runtimeError("Min expects exactly two arguments.");
             if (holds<int>(args[0]) && holds<int>(args[1])) {
                 int a = getVal<int>(args[0]), b = getVal<int>(args[1]);
@@ -5754,7 +8748,7 @@ void InitializeEnvironment(VM& vm) {
                 return a < b ? a : b;
             }
         }));
-        vm.environment->define("oct", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("oct", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Oct expects exactly one argument.");
             int n = 0;
             if (holds<int>(args[0])) n = getVal<int>(args[0]);
@@ -5764,40 +8758,40 @@ void InitializeEnvironment(VM& vm) {
             ss << std::oct << n;
             return ss.str();
         }));
-        vm.environment->define("pow", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("pow", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2) runtimeError("Pow expects exactly two arguments.");
             double a = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             double b = holds<int>(args[1]) ? getVal<int>(args[1]) : getVal<double>(args[1]);
             return std::pow(a, b);
         }));
-        vm.environment->define("round", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("round", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Round expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             return std::round(v);
         }));
-        vm.environment->define("sign", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("sign", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Sign expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             if (v < 0) return -1;
             else if (v == 0) return 0;
             else return 1;
         }));
-        vm.environment->define("sin", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("sin", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Sin expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             return std::sin(v);
         }));
-        vm.environment->define("sqrt", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("sqrt", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Sqrt expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             return std::sqrt(v);
         }));
-        vm.environment->define("tan", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("tan", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1) runtimeError("Tan expects exactly one argument.");
             double v = holds<int>(args[0]) ? getVal<int>(args[0]) : getVal<double>(args[0]);
             return std::tan(v);
         }));
-        vm.environment->define("rnd", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("rnd", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 0) runtimeError("Rnd expects no arguments.");
             std::uniform_real_distribution<double> dist(0.0, 1.0);
             std::lock_guard<std::mutex> lock(rngMutex);
@@ -5807,7 +8801,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: trim(input) as String
         // Returns the input string with both leading and trailing whitespace removed.
-        vm.environment->define("trim", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("trim", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1)
                 runtimeError("trim expects exactly one argument.");
             if (!holds<std::string>(args[0]))
@@ -5822,7 +8816,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: right(input, count) as String
         // Returns the rightmost 'count' characters of the input string.
-        vm.environment->define("right", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("right", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2)
                 runtimeError("right expects exactly two arguments: input and count.");
             if (!holds<std::string>(args[0]))
@@ -5840,7 +8834,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: left(input, count) as String
         // Returns the leftmost 'count' characters of the input string.
-        vm.environment->define("left", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("left", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 2)
                 runtimeError("left expects exactly two arguments: input and count.");
             if (!holds<std::string>(args[0]))
@@ -5859,7 +8853,7 @@ void InitializeEnvironment(VM& vm) {
         // Built-in function: titlecase(input) as String
         // Returns the string with each new word capitalized.
         // New words are assumed to start after any of these characters: space, newline, period, colon, or semicolon.
-        vm.environment->define("titlecase", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("titlecase", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1)
                 runtimeError("titlecase expects exactly one argument.");
             if (!holds<std::string>(args[0]))
@@ -5884,7 +8878,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: lowercase(input) as String
         // Returns the entire input string in lowercase.
-        vm.environment->define("lowercase", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("lowercase", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1)
                 runtimeError("lowercase expects exactly one argument.");
             if (!holds<std::string>(args[0]))
@@ -5896,7 +8890,7 @@ void InitializeEnvironment(VM& vm) {
 
         // Built-in function: uppercase(input) as String
         // Returns the entire input string in uppercase.
-        vm.environment->define("uppercase", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("uppercase", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 1)
                 runtimeError("uppercase expects exactly one argument.");
             if (!holds<std::string>(args[0]))
@@ -5909,7 +8903,7 @@ void InitializeEnvironment(VM& vm) {
         // Built-in function: middle(input as String, start as Number, length as Number) as String
         // Returns the substring starting at the 1-based position for the specified length.
         // If the start position is greater than the input length, returns an empty string.
-        vm.environment->define("middle", BuiltinFn([](const std::vector<Value>& args) -> Value {
+        vm.environment->define("middle", BuiltinFn([](ArgSpan args) -> Value {
             if (args.size() != 3)
                 runtimeError("middle expects exactly three arguments: input, start position, and length.");
             if (!holds<std::string>(args[0]))
@@ -5949,7 +8943,7 @@ void InitializeEnvironment(VM& vm) {
         {
             auto randomClass = std::make_shared<ObjClass>();
             randomClass->name = "random";
-            randomClass->methods["inrange"] = BuiltinFn([](const std::vector<Value>& args) -> Value {
+            randomClass->methods[intern("inrange")] = BuiltinFn([](ArgSpan args) -> Value {
                 if (args.size() != 2) runtimeError("Random.InRange expects exactly two arguments.");
                 int minVal = 0, maxVal = 0;
                 if (holds<int>(args[0]))
@@ -6121,7 +9115,7 @@ std::string decrypt(const std::string &cipher, const std::string &keyStr) {
         startTime = std::chrono::steady_clock::now();
         std::string filename = "default.xs";
         // Iterate through arguments, skipping argv[0] (program name)
-        for (int i = 1; i < argc - 1; i++) {
+        for (int i = 1; i < argc; i++) {
             std::string arg = argv[i];
             if (arg == "--s" && (i + 1 < argc)) {
                 filename = argv[i + 1];
@@ -6140,8 +9134,28 @@ std::string decrypt(const std::string &cipher, const std::string &keyStr) {
                     return 1;
                 }
             }
+            else if (arg == "--dc" && (i + 1 < argc)) {
+                // Trace only the listed categories (implies --d true)
+                if (!parseTraceCategories(argv[i + 1], DEBUG_CATEGORIES)) {
+                    std::cerr << "Error: Argument for --dc must be a comma-separated list of "
+                                 "general, compiler, vm, stack, plugin or all." << std::endl;
+                    return 1;
+                }
+                DEBUG_MODE = true;
+            }
+            else if (arg.compare(0, 2, "-O") == 0) {
+                // -O / -O1 run the peephole pass over compiled code; -O0 doesn't.
+                std::string level = arg.substr(2);
+                if (level.empty())
+                    OPTIMIZE_LEVEL = 1;
+                else if (!std::all_of(level.begin(), level.end(), ::isdigit) ||
+                         !_cbTryParseInt(level, OPTIMIZE_LEVEL)) {
+                    std::cerr << "Error: Unknown optimization level '" << arg << "'." << std::endl;
+                    return 1;
+                }
+            }
         }
-        debugLog(std::string("DEBUG_MODE: ") + (DEBUG_MODE ? "ON" : "OFF"));
+        DEBUG_TRACE(TRACE_GENERAL, std::string("DEBUG_MODE: ") + (DEBUG_MODE ? "ON" : "OFF"));
     ///////////////Initialize Envrironment////////////////
             // Create and initialize the VM environment.
             VM vm;
@@ -6181,32 +9195,33 @@ std::string decrypt(const std::string &cipher, const std::string &keyStr) {
         }
 
 
-        debugLog("Starting lexing...");
+        DEBUG_TRACE(TRACE_GENERAL, "Starting lexing...");
         Lexer lexer(source);
         auto tokens = lexer.scanTokens();
-        debugLog("Lexing complete. Tokens count: " + std::to_string(tokens.size()));
+        DEBUG_TRACE(TRACE_GENERAL, "Lexing complete. Tokens count: " + std::to_string(tokens.size()));
 
-        debugLog("Starting parsing...");
+        DEBUG_TRACE(TRACE_GENERAL, "Starting parsing...");
         Parser parser(tokens);
         std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
-        debugLog("Parsing complete. Statements count: " + std::to_string(statements.size()));
+        DEBUG_TRACE(TRACE_GENERAL, "Parsing complete. Statements count: " + std::to_string(statements.size()));
+        ConstantFolder().fold(statements);
     ///////////////////////////////////////
 
         // Compile the CrossBasic program.
-        debugLog("Starting compilation...");
+        DEBUG_TRACE(TRACE_GENERAL, "Starting compilation...");
         Compiler compiler(vm);
         compiler.compile(statements);
-        debugLog("Compilation complete. Main chunk instructions count: " + std::to_string(vm.mainChunk.code.size()));
+        DEBUG_TRACE(TRACE_GENERAL, "Compilation complete. Main chunk instructions count: " + std::to_string(vm.mainChunk.code.size()));
 
-        if (vm.environment->values.find("main") != vm.environment->values.end() &&
+        if (vm.environment->values.find(intern("main")) != vm.environment->values.end() &&
             (holds<std::shared_ptr<ObjFunction>>(vm.environment->get("main")) ||
             holds<std::vector<std::shared_ptr<ObjFunction>>>(vm.environment->get("main")))) {
             Value mainVal = vm.environment->get("main");
             if (holds<std::shared_ptr<ObjFunction>>(mainVal)) {
                 auto mainFunction = getVal<std::shared_ptr<ObjFunction>>(mainVal);
-                debugLog("Calling main function...");
+                DEBUG_TRACE(TRACE_GENERAL, "Calling main function...");
                 // Run the compiled bytecode
-                runVM(vm, mainFunction->chunk);
+                runFunction(vm, mainFunction, {});
             }
             else if (holds<std::vector<std::shared_ptr<ObjFunction>>>(mainVal)) {
                 auto overloads = getVal<std::vector<std::shared_ptr<ObjFunction>>>(mainVal);
@@ -6216,15 +9231,15 @@ std::string decrypt(const std::string &cipher, const std::string &keyStr) {
                 }
                 if (!mainFunction)
                     runtimeError("No main function with 0 parameters found.");
-                debugLog("Calling main function...");
-                runVM(vm, mainFunction->chunk);
+                DEBUG_TRACE(TRACE_GENERAL, "Calling main function...");
+                runFunction(vm, mainFunction, {});
             }
         }
         else {
-            debugLog("No main function found. Executing top-level code...");
+            DEBUG_TRACE(TRACE_GENERAL, "No main function found. Executing top-level code...");
             runVM(vm, vm.mainChunk);
         }
-        debugLog("Program execution finished.");
+        DEBUG_TRACE(TRACE_GENERAL, "Program execution finished.");
         return 0;
     }
 
@@ -6278,18 +9293,19 @@ const char* CompileAndRun(const char* code, bool enableDebug) {
     auto tokens = lexer.scanTokens();
     Parser parser(tokens);
     std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+    ConstantFolder().fold(statements);
     Compiler compiler(vm);
     compiler.compile(statements);
 
     // --- Run the compiled code ---
     // If a 'main' function exists, run it; otherwise run top-level code.
-    if (vm.environment->values.find("main") != vm.environment->values.end() &&
+    if (vm.environment->values.find(intern("main")) != vm.environment->values.end() &&
        (holds<std::shared_ptr<ObjFunction>>(vm.environment->get("main")) ||
         holds<std::vector<std::shared_ptr<ObjFunction>>>(vm.environment->get("main")))) {
         Value mainVal = vm.environment->get("main");
         if (holds<std::shared_ptr<ObjFunction>>(mainVal)) {
             auto mainFunction = getVal<std::shared_ptr<ObjFunction>>(mainVal);
-            runVM(vm, mainFunction->chunk);
+            runFunction(vm, mainFunction, {});
         } else if (holds<std::vector<std::shared_ptr<ObjFunction>>>(mainVal)) {
             auto overloads = getVal<std::vector<std::shared_ptr<ObjFunction>>>(mainVal);
             std::shared_ptr<ObjFunction> mainFunction = nullptr;
@@ -6298,7 +9314,7 @@ const char* CompileAndRun(const char* code, bool enableDebug) {
             }
             if (!mainFunction)
                 runtimeError("No main function with 0 parameters found.");
-            runVM(vm, mainFunction->chunk);
+            runFunction(vm, mainFunction, {});
         }
     } else {
         runVM(vm, vm.mainChunk);
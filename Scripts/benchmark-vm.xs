@@ -0,0 +1,57 @@
+' VM throughput benchmark – pure computation, no input and no plugins.
+' Used by benchmark_dispatch.sh to compare interpreter builds.
+
+Function Fib(n As Integer) As Integer
+  If n < 2 Then
+    Return n
+  End If
+  Return Fib(n - 1) + Fib(n - 2)
+End Function
+
+Class Counter
+  Dim total As Integer
+
+  Sub Constructor()
+    total = 0
+  End Sub
+
+  Sub Add(n As Integer)
+    total = total + n
+  End Sub
+End Class
+
+' Recursive calls
+Print("Fib(25) = " + Str(Fib(25)))
+
+' Integer loop with arithmetic
+Dim sum As Integer = 0
+For i As Integer = 1 To 500000
+  sum = sum + i Mod 7
+Next i
+Print("Loop sum = " + Str(sum))
+
+' Floating point amortization
+Dim balance As Double = 200000.0
+Dim monthlyRate As Double = 0.05 / 12
+Dim payment As Double = 1073.64
+Dim interestPaid As Double = 0.0
+For month As Integer = 1 To 360
+  Dim interest As Double = balance * monthlyRate
+  interestPaid = interestPaid + interest
+  balance = balance - (payment - interest)
+Next month
+Print("Interest paid = " + Str(interestPaid))
+
+' Method calls and property access
+Dim c As New Counter()
+For i As Integer = 1 To 50000
+  c.Add(i)
+Next i
+Print("Counter total = " + Str(c.total))
+
+' String building
+Dim s As String = ""
+For i As Integer = 1 To 2000
+  s = s + "x"
+Next i
+Print("String length = " + Str(Len(s)))
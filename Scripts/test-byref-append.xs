@@ -0,0 +1,26 @@
+' s = s + ... on a ByRef parameter must see writes made by calls
+' evaluated on the right-hand side, just like any other assignment.
+
+Dim g As String = "g"
+
+Function Bump() As String
+  g = "CHANGED"
+  Return "+"
+End Function
+
+Sub Build(ByRef s As String)
+  s = s + Bump()
+End Sub
+
+Sub BuildLocal(ByRef s As String)
+  Dim t As String = s
+  t = t + Bump() + "!"
+  s = t
+End Sub
+
+Build(g)
+print(g)           ' g+
+
+g = "h"
+BuildLocal(g)
+print(g)           ' h+!
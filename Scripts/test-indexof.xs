@@ -0,0 +1,89 @@
+' Array.IndexOf compares values the way = does: numbers numerically,
+' strings exactly and objects by identity. Arrays of 16 or more elements
+' build a hash index on their second search; every change drops it.
+
+Class Point
+  Dim x As Integer
+  Sub Constructor(px As Integer)
+    x = px
+  End Sub
+End Class
+
+Dim p1 As New Point(1)
+Dim p2 As New Point(1)
+Dim p3 As New Point(1)
+Dim pts() As Point
+pts.Add(p1)
+pts.Add(p2)
+print(Str(pts.IndexOf(p1)))       ' 0
+print(Str(pts.IndexOf(p2)))       ' 1, not 0: same class and fields, other object
+print(Str(pts.IndexOf(p3)))       ' -1
+
+Dim ints() As Integer = Array(10, 20, 30)
+print(Str(ints.IndexOf(20)))      ' 1
+print(Str(ints.IndexOf(20.0)))    ' 1
+print(Str(ints.IndexOf(20.5)))    ' -1
+print(Str(ints.IndexOf("20")))    ' -1
+
+Dim dbls() As Double = Array(1.5, 2.0, 3.5)
+print(Str(dbls.IndexOf(2)))       ' 1
+print(Str(dbls.IndexOf(3.5)))     ' 2
+
+Dim strs() As String = Array("a", "1", "B")
+print(Str(strs.IndexOf("1")))     ' 1
+print(Str(strs.IndexOf(1)))       ' -1
+print(Str(strs.IndexOf("b")))     ' -1
+
+' Large arrays: the first search scans, the second builds the index.
+Dim big() As Integer
+For i As Integer = 0 To 49
+  big.Add(i * 3)
+Next i
+big.Add(9)                        ' duplicate: the first position wins
+print(Str(big.IndexOf(9)))        ' 3
+print(Str(big.IndexOf(9)))        ' 3
+print(Str(big.IndexOf(9.0)))      ' 3
+print(Str(big.IndexOf(147)))      ' 49
+print(Str(big.IndexOf(148)))      ' -1
+
+big(3) = 1000
+print(Str(big.IndexOf(1000)))     ' 3
+print(Str(big.IndexOf(9)))        ' 50
+
+big.RemoveAt(0)
+print(Str(big.IndexOf(1000)))     ' 2
+print(Str(big.IndexOf(147)))      ' 48
+
+Dim last As Integer = big.Pop()
+print(Str(last))                  ' 9
+print(Str(big.IndexOf(9)))        ' -1
+big.Add(9)
+print(Str(big.IndexOf(9)))        ' 49
+
+' Generic storage goes through the same index.
+Dim names() As String
+For i As Integer = 0 To 19
+  names.Add("n" + Str(i))
+Next i
+print(Str(names.IndexOf("n7")))   ' 7
+print(Str(names.IndexOf("n7")))   ' 7
+names(7) = "seven"
+print(Str(names.IndexOf("n7")))   ' -1
+print(Str(names.IndexOf("seven"))) ' 7
+
+' SortWith reorders both arrays in place.
+Dim keys() As Integer
+Dim vals() As String
+For i As Integer = 0 To 19
+  keys.Add(19 - i)
+  vals.Add("v" + Str(19 - i))
+Next i
+print(Str(keys.IndexOf(0)))       ' 19
+print(Str(keys.IndexOf(0)))       ' 19
+print(Str(vals.IndexOf("v0")))    ' 19
+print(Str(vals.IndexOf("v0")))    ' 19
+SortWith(keys, vals)
+print(Str(keys.IndexOf(0)))       ' 0
+print(Str(keys.IndexOf(19)))      ' 19
+print(Str(vals.IndexOf("v0")))    ' 0
+print(Str(vals.IndexOf("v19")))   ' 19
@@ -0,0 +1,73 @@
+' The built-in Dictionary (no script Class Dictionary here, so New
+' Dictionary gets the native hash table). Keys keep insertion order.
+
+Dim d As New Dictionary
+d.Value("name") = "Alice"
+d.Value("age") = 30
+d.Value("city") = "Wonderland"
+d.Value("age") = 31                       ' overwrite keeps its position
+
+print(d.Value("name"))                    ' Alice
+print(Str(d.Value("age")))                ' 31
+print(Str(d.Count()))                     ' 3
+print(Str(d.HasKey("city")))              ' true
+print(Str(d.HasKey("zip")))               ' false
+print(d.Lookup("zip", "none"))            ' none
+print(d.Lookup("city", "none"))           ' Wonderland
+
+Sub Dump(label As String, dict As Dictionary)
+  Dim line As String = label + ":"
+  For i As Integer = 0 To dict.Count() - 1
+    line = line + " " + Str(dict.Key(i))
+  Next i
+  print(line)
+End Sub
+
+Dump("keys", d)                           ' keys: name age city
+
+d.Remove("name")
+print(Str(d.Count()))                     ' 2
+print(Str(d.HasKey("name")))              ' false
+Dump("after remove", d)                   ' after remove: age city
+
+Dim ks() As Variant = d.Keys()
+Dim vs() As Variant = d.Values()
+print(Str(ks.Count()) + " " + ks(0) + " " + ks(1))           ' 2 age city
+print(Str(vs(0)) + " " + vs(1))                               ' 31 Wonderland
+
+' Remove most of a large table, then enumerate: Key(i) rebuilds the
+' entries densely and must keep insertion order.
+Dim big As New Dictionary
+For i As Integer = 1 To 200
+  big.Value(i) = i * i
+Next i
+For i As Integer = 1 To 200
+  If i Mod 10 <> 0 Then big.Remove(i)
+Next i
+print(Str(big.Count()))                   ' 20
+Dim order As String = ""
+For i As Integer = 0 To big.Count() - 1
+  order = order + Str(big.Key(i)) + " "
+Next i
+print(order)                              ' 10 20 30 ... 200
+print(Str(big.Value(150)))                ' 22500
+big.Value(5) = 25                         ' re-added keys go to the end
+print(Str(big.Key(big.Count() - 1)))      ' 5
+print(Str(big.HasKey(11)))                ' false
+
+' Numerically equal keys are the same key.
+Dim n As New Dictionary
+n.Value(1) = "one"
+n.Value(1.0) = "one point oh"
+print(Str(n.Count()))                     ' 1
+print(n.Value(1))                         ' one point oh
+print(Str(n.HasKey(1.0)))                 ' true
+print(Str(n.HasKey("1")))                 ' false
+
+' d.Value on a missing key is a runtime error that ends the script
+' ("Dictionary.value: key not found: zip"), so look before reading.
+If d.HasKey("zip") Then
+  print(d.Value("zip"))
+Else
+  print("zip: not found")                 ' zip: not found
+End If
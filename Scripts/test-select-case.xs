@@ -0,0 +1,149 @@
+' Select Case: value lists, ranges, Is comparisons, Enum and String Cases.
+' All-constant Cases dispatch through a jump table; anything else is tested
+' in order. Either way the selector is evaluated exactly once.
+
+Enum Color
+  Red = 1
+  Green = 2
+  Blue = 40
+End Enum
+
+Function Name(n As Integer) As String
+  Select Case n
+    Case 1
+      Return "one"
+    Case 2, 3
+      Return "two or three"
+    Case 1
+      Return "one again"
+    Case Else
+      Return "other"
+  End Select
+End Function
+
+print(Name(1))     ' one
+print(Name(2))     ' two or three
+print(Name(3))     ' two or three
+print(Name(4))     ' other
+
+' Widely spread values use the sparse table.
+Function Sparse(n As Integer) As String
+  Select Case n
+    Case 7
+      Return "seven"
+    Case 100000
+      Return "big"
+    Case -100000, 7
+      Return "small"
+  End Select
+  Return "none"
+End Function
+
+print(Sparse(7))        ' seven
+print(Sparse(100000))   ' big
+print(Sparse(-100000))  ' small
+print(Sparse(8))        ' none
+
+Function Grade(score As Integer) As String
+  Select Case score
+    Case Is >= 90
+      Return "A"
+    Case 80 To 89
+      Return "B"
+    Case 0, 1 To 79
+      Return "C"
+    Case Else
+      Return "invalid"
+  End Select
+End Function
+
+print(Grade(95))   ' A
+print(Grade(90))   ' A
+print(Grade(85))   ' B
+print(Grade(0))    ' C
+print(Grade(50))   ' C
+print(Grade(-5))   ' invalid
+
+Function ColorName(c As Integer) As String
+  Select Case c
+    Case Color.Red
+      Return "red"
+    Case Color.Green
+      Return "green"
+    Case Color.Blue
+      Return "blue"
+    Case Else
+      Return "unknown"
+  End Select
+End Function
+
+print(ColorName(Color.Red))    ' red
+print(ColorName(40))           ' blue
+print(ColorName(3))            ' unknown
+
+' String Cases compare exactly, like =.
+Function Word(s As String) As String
+  Select Case s
+    Case "abc"
+      Return "lower"
+    Case "ABC"
+      Return "upper"
+    Case Else
+      Return "neither"
+  End Select
+End Function
+
+print(Word("abc"))   ' lower
+print(Word("ABC"))   ' upper
+print(Word("Abc"))   ' neither
+
+' A non-constant Case takes the ordered path, with the same result.
+Dim upperABC As String = "ABC"
+Function WordLinear(s As String) As String
+  Select Case s
+    Case "abc"
+      Return "lower"
+    Case upperABC
+      Return "upper"
+    Case Else
+      Return "neither"
+  End Select
+End Function
+
+print(WordLinear("abc"))   ' lower
+print(WordLinear("ABC"))   ' upper
+print(WordLinear("Abc"))   ' neither
+
+Dim calls As Integer = 0
+Function Pick() As Integer
+  calls = calls + 1
+  Return 5
+End Function
+
+Select Case Pick()
+  Case 1, 2, 3
+    print("low")
+  Case 5
+    print("five")
+End Select
+print("calls: " + Str(calls))   ' five, calls: 1
+
+calls = 0
+Select Case Pick()
+  Case Is < 0
+    print("negative")
+  Case 1 To 4
+    print("small")
+  Case Is = 6, Is = 5
+    print("five or six")
+End Select
+print("calls: " + Str(calls))   ' five or six, calls: 1
+
+calls = 0
+Select Case Pick()
+  Case 1
+    print("one")
+  Case Else
+    print("else")
+End Select
+print("calls: " + Str(calls))   ' else, calls: 1
@@ -0,0 +1,75 @@
+' And/Or skip the right operand once a Boolean left operand decides the
+' result. A left operand that is not a Boolean (an Integer, say) never
+' short-circuits, so the right operand is always evaluated.
+
+Dim log As String = ""
+
+Function B(name As String, result As Boolean) As Boolean
+  log = log + name
+  Return result
+End Function
+
+Function N(name As String, result As Integer) As Integer
+  log = log + name
+  Return result
+End Function
+
+Dim f As Boolean = False
+Dim t As Boolean = True
+
+log = ""
+If f And B("x", True) Then print("wrong")
+print("False And: [" + log + "]")    ' []
+
+log = ""
+If t And B("x", True) Then print("True And taken")
+print("True And: [" + log + "]")     ' [x]
+
+log = ""
+If t Or B("x", False) Then print("True Or taken")
+print("True Or: [" + log + "]")      ' []
+
+log = ""
+If f Or B("x", True) Then print("False Or taken")
+print("False Or: [" + log + "]")     ' [x]
+
+' The result of a skipped operand is the left operand itself.
+Dim r As Boolean = f And B("x", True)
+print(Str(r))                         ' false
+r = t Or B("x", False)
+print(Str(r))                         ' true
+
+log = ""
+r = N("a", 6) And N("b", 3)
+print(Str(r) + " [" + log + "]")      ' true [ab]
+
+log = ""
+r = N("a", 0) Or N("b", 5)
+print(Str(r) + " [" + log + "]")      ' true [ab]
+
+log = ""
+r = N("a", 0) And N("b", 5)
+print(Str(r) + " [" + log + "]")      ' false [ab]
+
+' Chains: each link stops at the first deciding operand.
+log = ""
+If B("a", True) And B("b", False) And B("c", True) Then print("wrong")
+print("a And b And c: [" + log + "]") ' [ab]
+
+log = ""
+If B("a", True) And B("b", True) And B("c", True) Then print("all true")
+print("a And b And c: [" + log + "]") ' [abc]
+
+log = ""
+If B("a", False) Or B("b", True) Or B("c", True) Then print("some true")
+print("a Or b Or c: [" + log + "]")   ' [ab]
+
+log = ""
+If B("a", False) And B("b", True) Or B("c", True) Then print("c decides")
+print("a And b Or c: [" + log + "]")  ' [ac]
+
+log = ""
+While B("w", False) And B("x", True)
+  print("wrong")
+Wend
+print("While: [" + log + "]")         ' [w]
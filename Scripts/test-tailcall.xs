@@ -0,0 +1,65 @@
+' A call in Return position reuses the caller's frame, so these recursions
+' run in constant stack. Without it they overflow long before 100000.
+
+Function Count(n As Integer, acc As Integer) As Integer
+  If n = 0 Then Return acc
+  Return Count(n - 1, acc + 1)
+End Function
+
+print(Str(Count(100000, 0)))      ' 100000
+
+Function IsEven(n As Integer) As Boolean
+  If n = 0 Then Return True
+  Return IsOdd(n - 1)
+End Function
+
+Function IsOdd(n As Integer) As Boolean
+  If n = 0 Then Return False
+  Return IsEven(n - 1)
+End Function
+
+print(Str(IsEven(100000)))        ' true
+print(Str(IsOdd(100001)))         ' true
+print(Str(IsOdd(100000)))         ' false
+
+Function SumTo(n As Integer, acc As Double) As Double
+  If n = 0 Then Return acc
+  Return SumTo(n - 1, acc + n)
+End Function
+
+print(Str(SumTo(100000, 0.0)))    ' 5000050000
+
+' ByRef arguments point into the caller's locals, so a tail call that
+' passes one keeps the caller's frame alive.
+Sub Bump(ByRef v As Integer)
+  v = v + 1
+End Sub
+
+Function Twice(v As Integer) As Integer
+  Return v * 2
+End Function
+
+Function AddTen(ByRef v As Integer) As Integer
+  v = v + 10
+  Return v
+End Function
+
+Function AfterBump(n As Integer) As Integer
+  Dim local As Integer = n
+  Bump(local)
+  Return Twice(local)
+End Function
+
+Function ByRefTail(n As Integer) As Integer
+  Dim local As Integer = n
+  Bump(local)
+  Return AddTen(local)
+End Function
+
+print(Str(AfterBump(4)))          ' 10
+print(Str(ByRefTail(4)))          ' 15
+
+Dim g As Integer = 1
+print(Str(ByRefTail(g)))          ' 12
+print(Str(AddTen(g)))             ' 11
+print(Str(g))                     ' 11
@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+set -euo pipefail
+
+# Builds CrossBasic twice – computed-goto dispatch (the default on GCC/Clang)
+# and the portable switch (-DCROSSBASIC_SWITCH_DISPATCH) – then times both
+# on the same scripts.
+#
+# Usage: ./benchmark_dispatch.sh [runs] [script.xs ...]
+#   runs     number of timed runs per script (default 5)
+#   scripts  defaults to Scripts/benchmark-vm.xs
+
+# --- Config ---
+SRC="./CrossBasic-SRC/crossbasic.cpp"
+OUT_DIR="bench-build"
+CXXFLAGS="-O3 -m64"
+
+RUNS="${1:-5}"
+shift || true
+SCRIPTS=("$@")
+if [[ ${#SCRIPTS[@]} -eq 0 ]]; then
+  SCRIPTS=("Scripts/benchmark-vm.xs")
+fi
+
+# --- Helper ---
+fail() {
+  echo "❌ ERROR: $*" >&2
+  exit 1
+}
+
+[[ -f "${SRC}" ]] || fail "Source file '${SRC}' not found."
+command -v g++ &>/dev/null || fail "g++ compiler not found in PATH."
+mkdir -p "${OUT_DIR}"
+
+echo "🔧 Building dispatch variants..."
+g++ ${CXXFLAGS} "${SRC}" -o "${OUT_DIR}/crossbasic-goto" -lffi || fail "goto build failed."
+g++ ${CXXFLAGS} -DCROSSBASIC_SWITCH_DISPATCH "${SRC}" -o "${OUT_DIR}/crossbasic-switch" -lffi || fail "switch build failed."
+
+# Best-of-N wall time in milliseconds.
+best_ms() {
+  local bin="$1" script="$2" best=""
+  for ((r = 0; r < RUNS; r++)); do
+    local start end ms
+    start=$(date +%s%N)
+    "${bin}" --s "${script}" </dev/null >/dev/null 2>&1 || true
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    if [[ -z "${best}" || ${ms} -lt ${best} ]]; then best=${ms}; fi
+  done
+  echo "${best}"
+}
+
+echo
+printf "%-40s %12s %12s %8s\n" "script" "switch(ms)" "goto(ms)" "speedup"
+for script in "${SCRIPTS[@]}"; do
+  [[ -f "${script}" ]] || { echo "[WARN] '${script}' not found; skipping."; continue; }
+  sw=$(best_ms "${OUT_DIR}/crossbasic-switch" "${script}")
+  cg=$(best_ms "${OUT_DIR}/crossbasic-goto" "${script}")
+  speedup=$(awk -v a="${sw}" -v b="${cg}" 'BEGIN { if (b > 0) printf "%.2fx", a / b; else print "n/a" }')
+  printf "%-40s %12s %12s %8s\n" "$(basename "${script}")" "${sw}" "${cg}" "${speedup}"
+done
+exit 0